@@ -0,0 +1,111 @@
+// Measures the cost of the LineRegistry lookups of an edge, find() of the
+// line behind an fd, then getOwner() and getIndex() of the line, with 8 to
+// 2048 registered lines. The cost per edge stays flat as the lines are indexed by
+// their fd. Run through 'meson test --benchmark' with -Dbenchmarks=enabled.
+
+#include "line_registry.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// edges handed to the registry for each number of lines
+constexpr size_t edgeCount = 4'000'000;
+// first fd of the lines, past the fds a daemon opens before its buttons
+constexpr int firstFd = 16;
+
+static double nanoseconds(Clock::duration duration, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(duration).count() /
+           static_cast<double>(count);
+}
+
+int main()
+{
+    auto& registry = LineRegistry::instance();
+
+    // the registry only compares the owners of the lines
+    int button = 0;
+    LineRegistry::Owner owner = &button;
+
+    std::mt19937 random(1);
+    bool flat = true;
+    double firstCost = 0;
+
+    std::cout << std::setw(8) << "lines" << std::setw(14) << "add ns/line"
+              << std::setw(14) << "edge ns" << std::setw(9) << "x 8" << "\n";
+
+    for (size_t lines = 8; lines <= 2048; lines *= 2)
+    {
+        std::vector<LineRegistry::Handle> handles;
+        auto start = Clock::now();
+        for (size_t line = 0; line < lines; line++)
+        {
+            handles.push_back(registry.add(firstFd + static_cast<int>(line),
+                                           owner,
+                                           static_cast<uint32_t>(line)));
+        }
+        auto addCost = nanoseconds(Clock::now() - start, lines);
+
+        // edges come from any line, in no particular order
+        std::vector<int> fds(edgeCount);
+        std::uniform_int_distribution<int> pick(
+            firstFd, firstFd + static_cast<int>(lines) - 1);
+        std::ranges::generate(fds, [&]() { return pick(random); });
+
+        uintptr_t owners = 0;
+        size_t indexes = 0;
+        start = Clock::now();
+        for (size_t edge = 0; edge < edgeCount; edge++)
+        {
+            auto handle = registry.find(fds[edge]);
+            owners += reinterpret_cast<uintptr_t>(registry.getOwner(handle));
+            indexes += registry.getIndex(handle);
+        }
+        auto edgeCost = nanoseconds(Clock::now() - start, edgeCount);
+
+        size_t expected = 0;
+        for (auto fd : fds)
+        {
+            expected += static_cast<size_t>(fd - firstFd);
+        }
+        if ((owners != reinterpret_cast<uintptr_t>(owner) * edgeCount) ||
+            (indexes != expected))
+        {
+            std::cerr << "Wrong line found for " << lines << " lines\n";
+            return 1;
+        }
+        for (auto handle : handles)
+        {
+            registry.remove(handle);
+        }
+
+        if (lines == 8)
+        {
+            firstCost = edgeCost;
+        }
+        // the lookups of 2048 lines don't fit in the L1 cache, allow for it
+        else if (edgeCost > 4 * firstCost)
+        {
+            flat = false;
+        }
+
+        std::cout << std::setw(8) << lines << std::fixed
+                  << std::setprecision(1) << std::setw(14) << addCost
+                  << std::setw(14) << edgeCost << std::setw(9)
+                  << edgeCost / firstCost << "\n";
+    }
+
+    if (!flat)
+    {
+        std::cerr << "The cost of an edge grows with the number of lines\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <systemd/sd-bus.h>
+#include <systemd/sd-event.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief serves a bus from an event loop, as sd_bus_attach_event() does,
+ * with a cap on the bus work. sd-event dispatches one source per iteration
+ * and sd-bus processes one message per dispatch. After maxBurst iterations
+ * in a row spent on the bus, the bus sits out the next iteration, so a
+ * pending input of a class below the bus is handled in the middle of a burst
+ * of messages. The inputs of a class above the bus still always run first.
+ */
+class BusSource
+{
+  public:
+    // bus dispatches in a row before the bus skips an iteration
+    static constexpr size_t maxBurst = 16;
+
+    // throws std::system_error when the sources can't be added
+    BusSource(sd_event* event, sd_bus* bus, int64_t priority);
+    ~BusSource();
+
+    BusSource(const BusSource&) = delete;
+    BusSource& operator=(const BusSource&) = delete;
+
+  private:
+    // fd events and timeout the bus waits for, before each iteration
+    static int prepare(sd_event_source* es, void* userdata);
+    static int io(sd_event_source* es, int fd, uint32_t revents,
+                  void* userdata);
+    static int time(sd_event_source* es, uint64_t usec, void* userdata);
+
+    // the resume source is a defer source at the idle priority: its prepare
+    // callback resumes the bus once an iteration went by without it, and it
+    // is dispatched in that iteration when no input was pending either
+    static int resumePrepare(sd_event_source* es, void* userdata);
+    static int resumeDispatch(sd_event_source* es, void* userdata);
+
+    void arm();
+    void process();
+    void pause();
+    void resume();
+
+    sd_bus* bus;
+    sd_event_source* ioSource = nullptr;
+    sd_event_source* timeSource = nullptr;
+    sd_event_source* resumeSource = nullptr;
+    size_t burst = 0;        // iterations in a row spent on the bus
+    bool dispatched = false; // in the last iteration
+    bool skipped = false;    // an iteration went by since the pause
+};
@@ -1,16 +1,62 @@
 #pragma once
+#include "button_gate.hpp"
 #include "config.hpp"
 #include "cpld.hpp"
 #include "gpio.hpp"
+#include "input.hpp"
+
+#include <systemd/sd-event.h>
 
 #include <nlohmann/json.hpp>
 
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 enum class ConfigType
 {
     gpio,
-    cpld
+    cpld,
+    input
+};
+
+// sd_event priority class of the io sources of a button, the pending
+// source with the lowest value is dispatched first
+enum class EventPriority : int64_t
+{
+    high = SD_EVENT_PRIORITY_IMPORTANT,
+    normal = SD_EVENT_PRIORITY_NORMAL,
+    low = SD_EVENT_PRIORITY_NORMAL + 50,
+};
+
+// the bus comes after the high class, with the normal class, a burst of
+// D-Bus messages is capped by BusSource so the low class gets its turn
+constexpr int64_t busEventPriority = SD_EVENT_PRIORITY_NORMAL;
+
+// sampling of the inputs of a button without interrupts
+struct PollingInfo
+{
+    bool enabled = false; // "polling_mode", i2c-dev registers always are
+    std::optional<std::chrono::milliseconds> interval;    // default per type
+    std::optional<std::chrono::milliseconds> maxInterval; // 4 * interval
+};
+
+// the host selector position of each value of the gpios of a selector
+struct HostSelectorInfo
+{
+    std::map<std::string, int> positionMap; // "host_selector_map"
+    size_t maxPosition = 0;                 // "max_position"
+};
+
+// the uart mux value of each host selector position
+struct SerialUartMuxInfo
+{
+    std::unordered_map<size_t, size_t> muxMap; // "serial_uart_mux_map"
 };
 
 // this struct represents button interface
@@ -20,7 +66,50 @@ struct ButtonConfig
     std::string formFactorName;   // name of the button interface
     std::vector<GpioInfo> gpios;  // holds single or group gpio config
     CpldInfo cpld;                // holds single cpld config
+    InputInfo input;              // holds single input device key config
     std::vector<int> fds;         // store all the fds listen io event which
                                   // mapped with the gpio or cpld
-    nlohmann::json extraJsonInfo; // corresponding to button interface
+    PollingInfo polling;          // "polling_*" keys of the definition
+    GateInfo gate;                // when the button is active
+    std::chrono::milliseconds debounce{0}; // settle time of the inputs,
+                                           // 0 when not debounced
+    EventPriority priority = EventPriority::normal;
+    std::string objectPath; // D-Bus object of the button, set by the factory
+    std::string fdStoreKey; // name of the fds of the button in the fd store,
+                            // changes with its definition
+
+    // the keys of a form factor, parsed for the buttons of that form factor
+    HostSelectorInfo hostSelector;
+    SerialUartMuxInfo serialUartMux;
 };
+
+/**
+ * @brief priority class of a button from the optional "priority" key of its
+ * definition, by default power and reset buttons come first and the serial
+ * uart mux last.
+ */
+EventPriority getEventPriority(const std::string& formFactorName,
+                               std::string_view priority);
+
+/**
+ * @brief EV_KEY code of an input button from its optional "key_code" key,
+ * power and reset buttons default to KEY_POWER and KEY_RESTART. The power,
+ * reset and ID buttons are the only ones bound to an input driver.
+ * @return std::nullopt for a button that can't be an input button
+ */
+std::optional<uint16_t> getKeyCode(const std::string& formFactorName,
+                                   std::optional<uint16_t> keyCode);
+
+/**
+ * @brief the configs of the buttons gpio_defs.json defines, in the order
+ * they are created: cpld, input then gpio definitions. The gpios are
+ * resolved to their gpiochip lines, the definitions the daemon doesn't
+ * serve are left out.
+ */
+std::vector<ButtonConfig> loadButtonConfigs(const std::string& path);
+
+/**
+ * @brief the same for the definitions compiled into the daemon with the
+ * 'platform-gpio-defs' meson option, see platform_tables.hpp
+ */
+std::vector<ButtonConfig> loadPlatformButtonConfigs();
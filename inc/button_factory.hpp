@@ -2,15 +2,29 @@
 
 #include "button_config.hpp"
 #include "button_interface.hpp"
+#include "common.hpp"
 #include "config.hpp"
 
 #include <phosphor-logging/elog-errors.hpp>
 
+#include <algorithm>
+#include <optional>
 #include <unordered_map>
+#include <utility>
 
 using buttonIfCreatorMethod = std::function<std::unique_ptr<ButtonIface>(
     sdbusplus::bus_t& bus, EventPtr& event, ButtonConfig& buttonCfg)>;
 
+// creator of the instance of a form factor, e.g. the power button of slot 1
+using indexedButtonIfCreatorMethod = std::function<std::unique_ptr<ButtonIface>(
+    sdbusplus::bus_t& bus, EventPtr& event, ButtonConfig& buttonCfg,
+    size_t index)>;
+
+// tag of a form factor that also takes indexed names, see ButtonIFRegister
+inline constexpr struct WithIndexedNames
+{
+} withIndexedNames;
+
 /**
  * @brief This is abstract factory for the creating phosphor buttons objects
  * based on the button  / formfactor type given.
@@ -39,24 +53,64 @@ class ButtonFactory
         buttonIfaceRegistry[T::getFormFactorName()] =
             [](sdbusplus::bus_t& bus, EventPtr& event,
                ButtonConfig& buttonCfg) {
-                return std::make_unique<T>(bus, T::getDbusObjectPath().c_str(),
-                                           event, buttonCfg);
+                buttonCfg.objectPath = T::getDbusObjectPath();
+                return makeButton<T>(bus, event, buttonCfg);
             };
     }
 
+    /**
+     * @brief registers a single creator for the instances of a form factor,
+     * named after it with the index of their slot appended, e.g.
+     * POWER_BUTTON1. As many instances are served as gpio_defs.json
+     * defines, the index is also appended to the object path.
+     */
     template <typename T>
-    void addToRegistry(size_t index)
+    void addIndexedToRegistry()
     {
-        auto indexStr = std::to_string(index);
-        buttonIfaceRegistry[T::getFormFactorName() + indexStr] =
-            [=](sdbusplus::bus_t& bus, EventPtr& event,
-                ButtonConfig& buttonCfg) {
-                return std::make_unique<T>(
-                    bus, (T::getDbusObjectPath() + indexStr).c_str(), event,
-                    buttonCfg);
+        indexedButtonIfaceRegistry[T::getFormFactorName()] =
+            [](sdbusplus::bus_t& bus, EventPtr& event, ButtonConfig& buttonCfg,
+               size_t index) {
+                buttonCfg.objectPath =
+                    T::getDbusObjectPath() + std::to_string(index);
+                return makeButton<T>(bus, event, buttonCfg);
             };
     }
 
+    /**
+     * @brief this method returns true if a button interface is
+     *    registered for the given formfactor name
+     */
+    bool isRegistered(const std::string& name) const
+    {
+        return buttonIfaceRegistry.contains(name) ||
+               parseIndexedName(name).has_value();
+    }
+
+    /**
+     * @brief the registered form factor names, sorted, e.g. to tell the
+     *    definitions compiled for another set of buttons
+     */
+    std::string getRegisteredNames() const
+    {
+        std::vector<std::string> names;
+        for (const auto& [name, creator] : buttonIfaceRegistry)
+        {
+            names.push_back(name);
+        }
+        for (const auto& [name, creator] : indexedButtonIfaceRegistry)
+        {
+            names.push_back(name + "<n>");
+        }
+        std::ranges::sort(names);
+
+        std::string registered;
+        for (const auto& name : names)
+        {
+            registered += name + ";";
+        }
+        return registered;
+    }
+
     /**
      * @brief this method returns the button interface object
      *    corresponding to the button formfactor name provided
@@ -71,6 +125,11 @@ class ButtonFactory
         {
             return objectIter->second(bus, event, buttonCfg);
         }
+        else if (auto indexed = parseIndexedName(name))
+        {
+            auto& [creator, index] = *indexed;
+            return (*creator)(bus, event, buttonCfg, index);
+        }
         else
         {
             return nullptr;
@@ -78,8 +137,53 @@ class ButtonFactory
     }
 
   private:
+    /**
+     * @brief splits an indexed form factor name, e.g. POWER_BUTTON2, into
+     * the creator of its form factor and its index, see splitIndexedName.
+     * @return std::nullopt when name is not an instance of a form factor
+     *    registered with indexed names
+     */
+    std::optional<std::pair<const indexedButtonIfCreatorMethod*, size_t>>
+        parseIndexedName(std::string_view name) const
+    {
+        auto indexed = splitIndexedName(name);
+        if (!indexed)
+        {
+            return std::nullopt;
+        }
+
+        auto creator =
+            indexedButtonIfaceRegistry.find(std::string(indexed->first));
+        if (creator == indexedButtonIfaceRegistry.end())
+        {
+            return std::nullopt;
+        }
+        return std::make_pair(&creator->second, indexed->second);
+    }
+
+    /**
+     * @brief creates a button on buttonCfg.objectPath. Its D-Bus object is
+     * created with deferred emission, and announced by ButtonIface::announce.
+     */
+    template <typename T>
+    static std::unique_ptr<ButtonIface> makeButton(
+        sdbusplus::bus_t& bus, EventPtr& event, ButtonConfig& buttonCfg)
+    {
+        auto button = std::make_unique<T>(bus, buttonCfg.objectPath.c_str(),
+                                          event, buttonCfg);
+        if constexpr (requires { button->emit_object_added(); })
+        {
+            button->setAnnouncer(
+                [object = button.get()]() { object->emit_object_added(); });
+        }
+        return button;
+    }
+
     // This map is the registry for keeping supported button interface types.
     std::unordered_map<std::string, buttonIfCreatorMethod> buttonIfaceRegistry;
+    // the form factors taking indexed names, by their name without index
+    std::unordered_map<std::string, indexedButtonIfCreatorMethod>
+        indexedButtonIfaceRegistry;
 };
 
 template <class T>
@@ -92,23 +196,13 @@ class ButtonIFRegister
         ButtonFactory::instance().addToRegistry<T>();
     }
 
-    explicit ButtonIFRegister(size_t count)
+    explicit ButtonIFRegister(WithIndexedNames)
     {
-        // The JSON power button definitions only have an instance in
-        // their name if there is more than 1 chassis.
-        if (instances.size() > 1)
-        {
-            // register the class factory function
-            // The index, 'countIter', starts at 1 and increments,
-            // representing slot_1 through slot_N.
-            for (size_t countIter = 1; countIter <= count; countIter++)
-            {
-                ButtonFactory::instance().addToRegistry<T>(countIter);
-            }
-        }
-        else
-        {
-            ButtonFactory::instance().addToRegistry<T>();
-        }
+        // The JSON definitions of a single chassis name the button without
+        // an instance, those of a multi chassis platform append the index
+        // of the slot, starting at 1. Both are served, the number of slots
+        // is the number of definitions.
+        ButtonFactory::instance().addToRegistry<T>();
+        ButtonFactory::instance().addIndexedToRegistry<T>();
     }
 };
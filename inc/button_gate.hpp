@@ -0,0 +1,88 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <sdbusplus/bus.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <variant>
+
+/**
+ * @brief the condition a button is active under, from the optional keys of
+ * its definition:
+ * - "presence_object": inventory item that must be Present, e.g. the sled
+ *   the button is on
+ * - "presence_default": "present" or "absent" (the default), the presence
+ *   assumed while the item can't be read or doesn't exist
+ * - "power_state": "on" or "off", the CurrentPowerState the chassis of
+ *   "power_state_object" (chassis0 by default) must be in
+ */
+struct GateInfo
+{
+    std::string presenceObject;   // empty when presence doesn't matter
+    std::string presenceDefault;  // "present", or "absent" when empty
+    std::string powerState;       // "on" or "off", empty when any
+    std::string powerStateObject; // chassis of powerState, empty for
+                                  // chassis0
+
+    GateInfo() = default;
+    explicit GateInfo(const nlohmann::json& config);
+
+    bool empty() const
+    {
+        return presenceObject.empty() && powerState.empty();
+    }
+};
+
+/**
+ * @brief follows the condition of a GateInfo. The properties are shared
+ * between the gates naming the same object. They are read once the event
+ * loop runs, through the mapper and without blocking the start, and are
+ * followed through PropertiesChanged, InterfacesAdded and InterfacesRemoved.
+ * Until the presence is read, or while its object is missing, the presence
+ * default applies. A power state that can't be read leaves the button
+ * active.
+ */
+class ButtonGate
+{
+  public:
+    // called with the new state when the gate opens or closes
+    using Changed = std::function<void(bool open)>;
+
+    /**
+     * @brief the gate of a button
+     * @return nullptr when the button is not gated
+     */
+    static std::unique_ptr<ButtonGate> create(sdbusplus::bus_t& bus,
+                                              const GateInfo& info,
+                                              Changed changed);
+
+    ButtonGate(sdbusplus::bus_t& bus, const GateInfo& info, Changed changed);
+    ~ButtonGate();
+
+    ButtonGate(const ButtonGate&) = delete;
+    ButtonGate& operator=(const ButtonGate&) = delete;
+
+    bool isOpen() const
+    {
+        return open;
+    }
+
+  private:
+    using Value = std::variant<bool, std::string>;
+
+    class Property;
+
+    // the state of the condition from the current values
+    bool evaluate() const;
+    // called by the properties when their value changes
+    void update();
+
+    Changed changed;
+    std::string powerState; // CurrentPowerState the button is active in
+    bool presentByDefault = false;
+    std::shared_ptr<Property> presence;
+    std::shared_ptr<Property> power;
+    bool open = true;
+};
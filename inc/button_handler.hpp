@@ -30,11 +30,6 @@ enum class PwrCtl
     chassisCycle,
 };
 
-inline static size_t numberOfChassis()
-{
-    return instances.size();
-}
-
 /**
  * @class Handler
  *
@@ -63,7 +58,21 @@ class Handler
      */
     explicit Handler(sdbusplus::bus_t& bus);
 
+    /**
+     * @brief rebuilds multiPwrBtnActConf after gpio_defs.json changed, the
+     * signal matches and the slots are kept. The tables are left as they
+     * were when the file can't be loaded.
+     */
+    void reloadMultiActions();
+
   private:
+    /**
+     * @brief fills multiPwrBtnActConf and powerButtonIndexes from the
+     * gpio_defs.json definitions, or from their compiled copy while the
+     * file is unchanged
+     */
+    void loadMultiActions();
+
     /**
      * @brief The handler for a power button press
      *
@@ -202,6 +211,17 @@ class Handler
      * @brief Flag to indicate if the button supports multi action
      */
     bool isButtonMultiActionSupport = true;
+
+    /**
+     * @brief the slots of a multi chassis platform, sorted: n for each
+     * POWER_BUTTON<n> definition the buttons daemon serves on Power0<n>
+     */
+    std::vector<size_t> powerButtonIndexes;
+
+    /**
+     * @brief number of chassis, from the power buttons found at start
+     */
+    size_t chassisCount = 1;
 };
 
 } // namespace button
@@ -1,71 +1,340 @@
 #pragma once
 
 #include "button_config.hpp"
+#include "button_gate.hpp"
 #include "common.hpp"
+#include "debounce_filter.hpp"
+#include "edge_capture.hpp"
+#include "fd_store.hpp"
+#include "line_registry.hpp"
+#include "poll_scheduler.hpp"
+#include "timer_wheel.hpp"
 #include "xyz/openbmc_project/Chassis/Common/error.hpp"
+#include "xyz/openbmc_project/State/Decorator/OperationalStatus/server.hpp"
 
 #include <phosphor-logging/elog-errors.hpp>
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/server/object.hpp>
+#include <sdeventplus/source/io.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+// delays between the attempts to bring back the lines of a failed button
+constexpr auto recoveryMinDelay = std::chrono::seconds(1);
+constexpr auto recoveryMaxDelay = std::chrono::minutes(5);
+
 // This is the base class for all the button interface types
 //
 class ButtonIface
 {
   public:
-    ButtonIface(sdbusplus::bus_t& bus, EventPtr& event, ButtonConfig& buttonCfg,
-                sd_event_io_handler_t handler = ButtonIface::EventHandler) :
-        bus(bus), event(event), config(buttonCfg), callbackHandler(handler)
+    ButtonIface(sdbusplus::bus_t& bus, EventPtr& event,
+                ButtonConfig& buttonCfg) :
+        bus(bus), event(event), config(buttonCfg)
     {
-        int ret = -1;
-        std::string configType;
+        // the health of the button, on the object of the button, announced
+        // with it
+        if (config.objectPath.starts_with('/'))
+        {
+            operationalStatus.emplace(
+                bus, config.objectPath.c_str(),
+                OperationalStatus::action::emit_no_signals);
+            operationalStatus->functional(true, true);
+        }
 
-        // config group gpio or cpld based on the defs read from the json file
-        if (buttonCfg.type == ConfigType::gpio)
+        // a button whose lines can't be configured is kept and retried in
+        // the background, the other buttons are not affected
+        if (configure() < 0)
         {
-            configType = "GPIO";
-            ret = configGroupGpio(config);
+            degrade();
         }
-        else if (buttonCfg.type == ConfigType::cpld)
+    }
+    virtual ~ButtonIface()
+    {
+        if (pollId)
         {
-            configType = "CPLD";
-            ret = configCpld(config);
+            PollScheduler::instance().remove(*pollId);
         }
-
-        if (ret < 0)
+        for (auto line : lines)
         {
-            phosphor::logging::log<phosphor::logging::level::ERR>(
-                (getFormFactorType() + " : failed to config " + configType)
-                    .c_str());
-            throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-                IOError();
+            LineRegistry::instance().remove(line);
         }
     }
-    virtual ~ButtonIface() {}
 
     /**
-     * @brief This method is called from sd-event provided callback function
-     * callbackHandler if platform specific event handling is needed then a
-     * derived class instance with its specific evend handling logic along with
-     * init() function can be created to override the default event handling.
+     * @brief This method is called from the io event sources of the button,
+     * if platform specific event handling is needed then a derived class
+     * instance with its specific event handling logic along with init()
+     * function can be created to override the default event handling.
      */
 
     virtual void handleEvent(sd_event_source* es, int fd, uint32_t revents) = 0;
-    static int EventHandler(sd_event_source* es, int fd, uint32_t revents,
-                            void* userdata)
+
+    const std::string& getFormFactorType() const
     {
-        if (userdata)
+        return config.formFactorName;
+    }
+
+    // identifies the definition the button was created from, it changes with
+    // the definition
+    const std::string& getDefinitionKey() const
+    {
+        return config.fdStoreKey;
+    }
+
+    /**
+     * @brief the D-Bus objects of the buttons are created without signals,
+     * and announced once every button is configured. announcer emits the
+     * InterfacesAdded of the object, with every interface on its path.
+     */
+    void setAnnouncer(std::function<void()> announcer)
+    {
+        announceObject = std::move(announcer);
+    }
+
+    // emits the InterfacesAdded of the object of the button, once
+    void announce()
+    {
+        if (announced)
+        {
+            return;
+        }
+        announced = true;
+        if (announceObject)
         {
-            ButtonIface* buttonIface = static_cast<ButtonIface*>(userdata);
-            buttonIface->handleEvent(es, fd, revents);
+            announceObject();
         }
+    }
 
-        return 0;
+    /**
+     * @brief takes the button out for good before it is destroyed, when its
+     * definition is removed or changed: its event sources are removed and
+     * its fds closed and dropped from the fd store, so that its lines can be
+     * requested again.
+     */
+    void retire()
+    {
+        FdStore::instance().remove(config);
+        deInit();
     }
 
-    std::string getFormFactorType() const
+    /**
+     * @brief hands edges that were not read from fd by the event loop, such
+     * as the changes found by a poll or the edges of the capture thread, to
+     * handleEvent() through readEdges().
+     */
+    void injectEdges(int fd, std::span<const GpioEdge> edges)
     {
-        return config.formFactorName;
+        injectedEdges = edges;
+        handleEvent(nullptr, fd, 0);
+        injectedEdges.reset();
+    }
+
+    /**
+     * @brief takes the button out of service after an I/O error: its event
+     * sources are removed, its fds closed and Functional is cleared on
+     * D-Bus. The lines are configured again after a delay that doubles with
+     * every failed attempt.
+     */
+    void degrade()
+    {
+        FdStore::instance().remove(config);
+        releaseSources();
+        if (debounce)
+        {
+            debounce->clear();
+        }
+        polledStates.clear();
+
+        functional = false;
+        if (operationalStatus)
+        {
+            // no signal for an object that isn't announced yet
+            operationalStatus->functional(false, !announced);
+        }
+
+        if (!recoveryTimer)
+        {
+            recoveryTimer.emplace([this]() { recover(); });
+        }
+        recoveryTimer->restartOnce(recoveryDelay);
+
+        lg2::error("{TYPE}: degraded, retrying in {DELAY_MS}ms", "TYPE",
+                   getFormFactorType(), "DELAY_MS",
+                   std::chrono::duration_cast<std::chrono::milliseconds>(
+                       recoveryDelay)
+                       .count());
+        recoveryDelay = std::min<std::chrono::milliseconds>(
+            recoveryDelay * 2, recoveryMaxDelay);
+    }
+
+    bool isFunctional() const
+    {
+        return functional;
+    }
+
+    /**
+     * @brief turns the button off while its gate is closed: its event
+     * sources and polls are disabled, so its lines cause no wakeup, but they
+     * stay configured. Reopening the gate drops what the lines queued in
+     * between and resumes the button.
+     */
+    void setGated(bool closed)
+    {
+        if (gated == closed)
+        {
+            return;
+        }
+        gated = closed;
+        lg2::info("{TYPE}: {STATE}", "TYPE", getFormFactorType(), "STATE",
+                  closed ? "gated off" : "resumed");
+
+        if (pollId)
+        {
+            PollScheduler::instance().setEnabled(*pollId, !closed);
+        }
+        polledStates.clear();
+
+        // a degraded button applies the gate once it recovers
+        if (functional)
+        {
+            enableSources(!closed);
+        }
     }
 
   protected:
+    /**
+     * @brief reads the edges behind an io event fd through the shared line
+     * reader, decoded by the polarity of the gpio owning the fd, then
+     * through the software debounce filter when the button has one.
+     * @return the edges read, valid until the next call, or std::nullopt
+     * on a read error
+     */
+    GpioLineReader::Edges readEdges(int fd)
+    {
+        auto edges = injectedEdges ? injectedEdges : readLineEdges(fd);
+        if (edges && debounce)
+        {
+            edges = debounce->filter(fd, *edges);
+        }
+        return edges;
+    }
+
+    /**
+     * @brief reads the edges behind an io event fd, unfiltered. A cpld
+     * register is decoded by the spec of the button, a value of 0 being
+     * asserted.
+     */
+    GpioLineReader::Edges readLineEdges(int fd)
+    {
+        GpioLineReader::Edges edges;
+
+        // input devices and i2c-dev cpld registers are read by their shared
+        // device, which injects the edges of the button
+        if (isSharedDevice())
+        {
+            return std::span<const GpioEdge>();
+        }
+
+        auto& registry = LineRegistry::instance();
+        auto line = registry.find(fd);
+        if ((line != LineRegistry::invalidHandle) &&
+            (registry.getOwner(line) == this))
+        {
+            if (config.type == ConfigType::cpld)
+            {
+                edges = lineReader.readCpld(fd, config.cpld.decoder);
+            }
+            else
+            {
+                edges = lineReader.read(config.gpios[registry.getIndex(line)]);
+            }
+        }
+
+        if (!edges)
+        {
+            lg2::error("{TYPE}: read error on fd {FD}", "TYPE",
+                       getFormFactorType(), "FD", fd);
+            degrade();
+        }
+        return edges;
+    }
+
+    /**
+     * @brief samples the inputs of the button for the poll scheduler. The
+     * lines that changed since the last poll are handed to handleEvent() as
+     * edges, the first poll only records the initial states. A derived
+     * class can override it to sample its inputs differently.
+     * @return true when an input changed
+     */
+    virtual bool poll()
+    {
+        // an input device reports every key change, and the i2c-dev cpld
+        // devices are sampled as a whole, nothing to sample
+        if (!isFunctional() || isSharedDevice())
+        {
+            return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        bool changed = false;
+
+        auto update = [&](size_t index, int fd, GpioState state) {
+            if (polledStates[index] == state)
+            {
+                return;
+            }
+            bool first = (polledStates[index] == GpioState::invalid);
+            polledStates[index] = state;
+            if (!first)
+            {
+                GpioEdge edge{state, now};
+                injectEdges(fd, std::span(&edge, 1));
+                changed = true;
+            }
+        };
+
+        if (config.type == ConfigType::cpld)
+        {
+            polledStates.resize(config.fds.size(), GpioState::invalid);
+            for (size_t index = 0; index < config.fds.size(); index++)
+            {
+                int fd = config.fds[index];
+                auto edges = lineReader.readCpld(fd, config.cpld.decoder);
+                if (!edges)
+                {
+                    degrade();
+                    return changed;
+                }
+                if (!edges->empty())
+                {
+                    update(index, fd, edges->back().state);
+                }
+            }
+            return changed;
+        }
+
+        // all the lines of the button are sampled together
+        polledValues.resize(config.gpios.size());
+        polledStates.resize(config.gpios.size(), GpioState::invalid);
+        if (readGroupGpioValues(config.gpios, polledValues) < 0)
+        {
+            lg2::error("{TYPE}: failed to poll gpios", "TYPE",
+                       getFormFactorType());
+            degrade();
+            return false;
+        }
+        for (size_t index = 0; index < config.gpios.size(); index++)
+        {
+            const auto& gpio = config.gpios[index];
+            update(index, gpio.fd,
+                   toGpioState(gpio.polarity, polledValues[index]));
+        }
+        return changed;
+    }
+
     /**
      * @brief oem specific initialization can be done under init function.
      * if platform specific initialization is needed then
@@ -75,35 +344,366 @@ class ButtonIface
 
     virtual void init()
     {
-        // initialize the button io fd from the ButtonConfig
-        // which has fd stored when configGroupGpio or configCpld is called
+        // a button of an empty slot, or one that does nothing in the current
+        // power state, is kept idle
+        gate = ButtonGate::create(bus, config.gate,
+                                  [this](bool open) { setGated(!open); });
+        gated = gate && !gate->isOpen();
+
+        // line requests and input devices are debounced by the kernel, the
+        // other lines but i2c-dev registers are resampled once they settle
+        if (!isLineRequest() && !isSharedDevice() &&
+            (config.debounce.count() > 0))
+        {
+            debounce.emplace(config.debounce,
+                             [this](int fd) { handleEvent(nullptr, fd, 0); });
+        }
+
+        // inputs without interrupts are sampled by the poll scheduler
+        if (config.polling.enabled && !isI2cCpld())
+        {
+            auto interval = config.polling.interval.value_or(
+                std::chrono::milliseconds(1000));
+            auto maxInterval =
+                config.polling.maxInterval.value_or(4 * interval);
+            pollId = PollScheduler::instance().add(interval, maxInterval,
+                                                   [this]() { return poll(); });
+            PollScheduler::instance().setEnabled(*pollId, !gated);
+        }
+
+        // a button degraded by the constructor has no lines to watch yet,
+        // they are added once the retry configures them
+        if (!functional)
+        {
+            return;
+        }
+        if (addSources() < 0)
+        {
+            degrade();
+            return;
+        }
+        FdStore::instance().store(config);
+        if (gated)
+        {
+            enableSources(false);
+        }
+    }
+
+    /**
+     * @brief called once the sources of a gated button are back on, a
+     * derived class can read the inputs that may have changed meanwhile.
+     */
+    virtual void resumed() {}
+
+    // disables or enables the event sources of the configured lines
+    void enableSources(bool enabled)
+    {
+        if (config.type == ConfigType::input)
+        {
+            InputDevices::instance().setEnabled(*this, enabled);
+        }
+        else if (isI2cCpld())
+        {
+            CpldDevices::instance().setEnabled(*this, enabled);
+        }
+        else if (debounce)
+        {
+            debounce->clear();
+        }
+
+        if (enabled && !isSharedDevice())
+        {
+            // drop the edges queued while off, before anything else reads
+            // the lines, and start again from their current states
+            for (auto fd : config.fds)
+            {
+                for (size_t count = 0; count < maxGpioEdges; count++)
+                {
+                    auto edges = readLineEdges(fd);
+                    if (!edges)
+                    {
+                        return;
+                    }
+                    if (!edges->empty() && debounce)
+                    {
+                        debounce->track(fd, edges->back().state);
+                    }
+                    if (!isLineRequest() || edges->empty())
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (auto& source : eventSources)
+        {
+            source.set_enabled(enabled ? sdeventplus::source::Enabled::On
+                                       : sdeventplus::source::Enabled::Off);
+        }
+        if (EDGE_CAPTURE_THREAD)
+        {
+            EdgeCapture::instance().setEnabled(*this, enabled);
+        }
+
+        if (enabled)
+        {
+            resumed();
+        }
+    }
+
+    // gpio line requests report edges as readable events, sysfs value and
+    // cpld attributes notify through POLLPRI
+    bool isLineRequest() const
+    {
+        return GPIO_CHARDEV && (config.type == ConfigType::gpio);
+    }
+
+    // a cpld register read through i2c-dev instead of its sysfs attribute
+    bool isI2cCpld() const
+    {
+        return (config.type == ConfigType::cpld) &&
+               config.cpld.registerOffset.has_value();
+    }
+
+    // the button has no fd of its own, its edges are injected by the device
+    // it shares with other buttons
+    bool isSharedDevice() const
+    {
+        return (config.type == ConfigType::input) || isI2cCpld();
+    }
+
+    /**
+     * @brief configures the gpios or the cpld register of the button from
+     * the defs read from the json file, storing their fds in config.
+     * @return int returns 0 on success, -1 on error
+     */
+    int configure()
+    {
+        int ret = -1;
+
+        // lines adopted from the fd store are configured already
+        if (isConfigured())
+        {
+            return 0;
+        }
+
+        if (config.type == ConfigType::gpio)
+        {
+            ret = configGroupGpio(config);
+        }
+        else if (config.type == ConfigType::cpld)
+        {
+            ret = configCpld(config);
+        }
+        else if (config.type == ConfigType::input)
+        {
+            ret = configInput(config);
+        }
+
+        if (ret < 0)
+        {
+            lg2::error("{TYPE}: failed to config {CONFIG_TYPE}", "TYPE",
+                       getFormFactorType(), "CONFIG_TYPE",
+                       (config.type == ConfigType::cpld)    ? "CPLD"
+                       : (config.type == ConfigType::input) ? "INPUT"
+                                                            : "GPIO");
+        }
+        return ret;
+    }
+
+    // true when every line already has its fd, e.g. adopted from the fd store
+    bool isConfigured() const
+    {
+        // an input device is looked up again, its eventN may have changed,
+        // and an i2c-dev device is opened by the first button on it
+        if (isSharedDevice())
+        {
+            return false;
+        }
+        if (config.type == ConfigType::cpld)
+        {
+            return config.cpld.cpldMappedFd >= 0;
+        }
+        return !config.gpios.empty() &&
+               std::ranges::all_of(config.gpios, [](const auto& gpio) {
+                   return gpio.fd >= 0;
+               });
+    }
+
+    /**
+     * @brief adds the fds stored in config to the event loop, or to the
+     * edge capture thread. An input device is shared by its buttons and
+     * always read on the event loop, its events carry kernel timestamps.
+     * @return int returns 0 on success, a negative errno on error
+     */
+    int addSources()
+    {
+        if (config.type == ConfigType::input)
+        {
+            return InputDevices::instance().add(
+                event.get(), config.input,
+                static_cast<int64_t>(config.priority), *this);
+        }
+        if (isI2cCpld())
+        {
+            auto interval = config.polling.interval.value_or(
+                std::chrono::milliseconds(100));
+            auto maxInterval =
+                config.polling.maxInterval.value_or(4 * interval);
+            return CpldDevices::instance().add(config.cpld, interval,
+                                               maxInterval, *this);
+        }
+
+        auto& registry = LineRegistry::instance();
+        if (config.type == ConfigType::cpld)
+        {
+            for (uint32_t index = 0; index < config.fds.size(); index++)
+            {
+                auto line = registry.add(config.fds[index], this, index);
+                if (line == LineRegistry::invalidHandle)
+                {
+                    return -EBADF;
+                }
+                lines.push_back(line);
+            }
+        }
+        else
+        {
+            for (uint32_t index = 0; index < config.gpios.size(); index++)
+            {
+                auto line = registry.add(config.gpios[index].fd, this, index);
+                if (line == LineRegistry::invalidHandle)
+                {
+                    return -EBADF;
+                }
+                lines.push_back(line);
+            }
+        }
+
         for (auto fd : config.fds)
         {
-            char buf;
+            int ret = 0;
 
-            int ret = ::read(fd, &buf, sizeof(buf));
-            if (ret < 0)
+            if (!isLineRequest())
             {
-                phosphor::logging::log<phosphor::logging::level::ERR>(
-                    (getFormFactorType() + " : read error!").c_str());
+                // the first read clears the pending notification
+                auto edges = readLineEdges(fd);
+                if (!edges)
+                {
+                    return -EIO;
+                }
+                if (!edges->empty() && debounce)
+                {
+                    debounce->track(fd, edges->back().state);
+                }
             }
 
-            ret = sd_event_add_io(event.get(), nullptr, fd, EPOLLPRI,
-                                  callbackHandler, this);
-            if (ret < 0)
+            uint32_t events = isLineRequest() ? EPOLLIN : EPOLLPRI;
+            if (EDGE_CAPTURE_THREAD)
             {
-                phosphor::logging::log<phosphor::logging::level::ERR>(
-                    (getFormFactorType() + " : failed to add to event loop")
-                        .c_str());
-                if (fd > 0)
+                std::optional<GpioInfo> gpio;
+                auto line = registry.find(fd);
+                if (config.type == ConfigType::gpio)
                 {
-                    ::close(fd);
+                    gpio = config.gpios[registry.getIndex(line)];
                 }
-                throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-                    IOError();
+                ret = EdgeCapture::instance().add(
+                    event.get(), fd, events, gpio,
+                    gpio ? nullptr : &config.cpld.decoder, *this);
+            }
+            else
+            {
+                try
+                {
+                    auto& source = eventSources.emplace_back(
+                        sdeventplus::Event(event.get()), fd, events,
+                        [this](sdeventplus::source::IO& io, int fd,
+                               uint32_t revents) {
+                            handleEvent(io.get(), fd, revents);
+                        });
+                    source.set_priority(static_cast<int64_t>(config.priority));
+                }
+                catch (const std::system_error& e)
+                {
+                    ret = -e.code().value();
+                }
+            }
+            if (ret < 0)
+            {
+                lg2::error("{TYPE}: failed to add to event loop: {ERROR}",
+                           "TYPE", getFormFactorType(), "ERROR", ret);
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    // removes the event sources of the button and closes its fds
+    void releaseSources()
+    {
+        eventSources.clear();
+
+        if (EDGE_CAPTURE_THREAD)
+        {
+            // closed once the thread is done with them
+            EdgeCapture::instance().remove(*this, std::move(config.fds));
+            config.fds.clear();
+        }
+        if (config.type == ConfigType::input)
+        {
+            InputDevices::instance().remove(*this);
+            config.input.fd = -1;
+        }
+        if (isI2cCpld())
+        {
+            CpldDevices::instance().remove(*this);
+        }
+        for (auto line : lines)
+        {
+            LineRegistry::instance().remove(line);
+        }
+        lines.clear();
+
+        for (auto fd : config.fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
             }
         }
+        config.fds.clear();
+
+        for (auto& gpio : config.gpios)
+        {
+            gpio.fd = -1;
+        }
+        config.cpld.cpldMappedFd = -1;
+    }
+
+    // configures the lines of a degraded button again
+    void recover()
+    {
+        if ((configure() < 0) || (addSources() < 0))
+        {
+            degrade();
+            return;
+        }
+
+        FdStore::instance().store(config);
+        if (gated)
+        {
+            enableSources(false);
+        }
+        recoveryDelay = recoveryMinDelay;
+        functional = true;
+        if (operationalStatus)
+        {
+            operationalStatus->functional(true, !announced);
+        }
+        lg2::info("{TYPE}: recovered", "TYPE", getFormFactorType());
     }
+
     /**
      * @brief similar to init() oem specific deinitialization can be done under
      * deInit function. if platform specific deinitialization is needed then a
@@ -112,17 +712,31 @@ class ButtonIface
      */
     virtual void deInit()
     {
-        for (auto fd : config.fds)
-        {
-            if (fd > 0)
-            {
-                ::close(fd);
-            }
-        }
+        releaseSources();
     }
 
     sdbusplus::bus_t& bus;
     EventPtr& event;
     ButtonConfig config;
-    sd_event_io_handler_t callbackHandler;
+    GpioLineReader lineReader;
+    std::optional<DebounceFilter> debounce;
+    std::optional<size_t> pollId;
+    std::vector<sdeventplus::source::IO> eventSources;
+    std::vector<LineRegistry::Handle> lines; // of the configured lines
+    GpioLineReader::Edges injectedEdges;
+    std::vector<GpioState> polledStates; // per gpio, or per fd for a cpld
+    std::vector<uint8_t> polledValues;
+
+    using OperationalStatus = sdbusplus::server::object_t<
+        sdbusplus::xyz::openbmc_project::State::Decorator::server::
+            OperationalStatus>;
+
+    std::optional<OperationalStatus> operationalStatus;
+    std::function<void()> announceObject;
+    bool announced = false; // the object was announced on D-Bus
+    std::optional<TimerWheel::Timer> recoveryTimer;
+    std::unique_ptr<ButtonGate> gate;
+    bool gated = false; // the gate of the button is closed
+    std::chrono::milliseconds recoveryDelay = recoveryMinDelay;
+    bool functional = true;
 };
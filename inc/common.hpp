@@ -18,7 +18,11 @@
 
 #include <systemd/sd-event.h>
 
+#include <charconv>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
 
 struct EventDeleter
 {
@@ -28,3 +32,28 @@ struct EventDeleter
     }
 };
 using EventPtr = std::unique_ptr<sd_event, EventDeleter>;
+
+/**
+ * @brief splits an indexed form factor name, e.g. POWER_BUTTON2, into its
+ * form factor and its index. The index starts at 1, without leading zeros,
+ * so each instance has a single name.
+ * @return std::nullopt when name doesn't end with an index
+ */
+inline std::optional<std::pair<std::string_view, size_t>>
+    splitIndexedName(std::string_view name)
+{
+    auto digits = name.find_last_not_of("0123456789") + 1;
+    if ((digits == 0) || (digits == name.size()) || (name[digits] == '0'))
+    {
+        return std::nullopt;
+    }
+
+    size_t index = 0;
+    const char* last = name.data() + name.size();
+    auto [end, error] = std::from_chars(name.data() + digits, last, index);
+    if ((error != std::errc()) || (end != last))
+    {
+        return std::nullopt;
+    }
+    return std::make_pair(name.substr(0, digits), index);
+}
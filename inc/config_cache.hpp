@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief 64 bit FNV-1a hash of text. Unlike std::hash it is the same on
+ * every architecture and standard library, so the keys of what outlives a
+ * start, the caches and the fds in the fd store, survive an update of the
+ * daemon that doesn't change them.
+ */
+constexpr uint64_t hashText(std::string_view text)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto character : text)
+    {
+        hash ^= static_cast<uint8_t>(character);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/**
+ * @brief hashes the content of a file, such as gpio_defs.json, into the key
+ * of the caches compiled from it
+ * @param[out] content - the content of the file
+ * @return the hash, std::nullopt when the file can't be read
+ */
+std::optional<uint64_t> hashConfigFile(const std::string& path,
+                                       std::string& content);
+
+/**
+ * @brief builds a binary cache of what a daemon compiled from its config,
+ * as plain values and length prefixed strings in host byte order.
+ */
+class ConfigCacheWriter
+{
+  public:
+    template <typename T>
+        requires std::is_trivially_copyable_v<T> && (!std::is_same_v<T, bool>)
+    void write(const T& value)
+    {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void write(bool value)
+    {
+        write(static_cast<uint8_t>(value));
+    }
+
+    void write(std::string_view text)
+    {
+        write(static_cast<uint32_t>(text.size()));
+        bytes.append(text);
+    }
+
+    /**
+     * @brief writes the cache for key, through a copy so a crash never
+     * leaves a truncated cache
+     * @return false on error
+     */
+    bool save(const std::string& path, uint64_t key) const;
+
+  private:
+    std::string bytes;
+};
+
+/**
+ * @brief maps a cache written by ConfigCacheWriter and reads its values in
+ * the order they were written, straight from the mapping.
+ */
+class ConfigCacheReader
+{
+  public:
+    /**
+     * @brief maps the cache at path
+     * @return std::nullopt when there is no cache, or one written for
+     * another key
+     */
+    static std::optional<ConfigCacheReader> open(const std::string& path,
+                                                 uint64_t key);
+
+    ConfigCacheReader(const ConfigCacheReader&) = delete;
+    ConfigCacheReader& operator=(const ConfigCacheReader&) = delete;
+    ConfigCacheReader(ConfigCacheReader&& other) noexcept;
+    ConfigCacheReader& operator=(ConfigCacheReader&&) = delete;
+    ~ConfigCacheReader();
+
+    // reads the next value, false past the end of the cache. An enum or a
+    // bool read from the file must be checked, see below.
+    template <typename T>
+        requires std::is_trivially_copyable_v<T> && (!std::is_enum_v<T>) &&
+                 (!std::is_same_v<T, bool>)
+    bool read(T& value)
+    {
+        if (data.size() < sizeof(value))
+        {
+            return false;
+        }
+        std::memcpy(&value, data.data(), sizeof(value));
+        data = data.subspan(sizeof(value));
+        return true;
+    }
+
+    // reads the next enum value, false when it isn't one of values
+    template <typename T>
+        requires std::is_enum_v<T>
+    bool read(T& value, std::initializer_list<T> values)
+    {
+        std::underlying_type_t<T> raw{};
+        if (!read(raw))
+        {
+            return false;
+        }
+        value = static_cast<T>(raw);
+        return std::ranges::find(values, value) != values.end();
+    }
+
+    // reads the next bool, written as a uint8_t
+    bool read(bool& value)
+    {
+        uint8_t raw = 0;
+        if (!read(raw) || (raw > 1))
+        {
+            return false;
+        }
+        value = (raw == 1);
+        return true;
+    }
+
+    // reads the next string, a view into the mapping
+    bool read(std::string_view& text);
+
+    bool atEnd() const
+    {
+        return data.empty();
+    }
+
+  private:
+    ConfigCacheReader(void* mapping, size_t size, std::span<const char> data);
+
+    void* mapping;
+    size_t size;
+    std::span<const char> data; // not read yet
+};
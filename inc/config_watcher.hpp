@@ -0,0 +1,41 @@
+#pragma once
+
+#include "timer_wheel.hpp"
+
+#include <systemd/sd-event.h>
+
+#include <sdeventplus/source/io.hpp>
+
+#include <functional>
+#include <optional>
+#include <string>
+
+/**
+ * @brief calls back when a config file is written or replaced. The
+ * directory of the file is watched through inotify, so a file replaced by a
+ * rename, as editors and package updates do, is seen as well. The events of
+ * one update are coalesced: the callback runs once the file has been quiet
+ * for a short while.
+ */
+class ConfigWatcher
+{
+  public:
+    using Changed = std::function<void()>;
+
+    ConfigWatcher(sd_event* event, const std::string& path, Changed changed);
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+  private:
+    // reads the pending inotify events, arming the settle timer when one is
+    // about the file
+    void dispatch();
+
+    std::string name; // of the file in its directory
+    int fd = -1;      // inotify instance
+    std::optional<sdeventplus::source::IO> source;
+    TimerWheel::Timer settleTimer;
+    Changed changed;
+};
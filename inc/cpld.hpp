@@ -1,18 +1,274 @@
 
 #pragma once
 #include "config.hpp"
+#include "gpio.hpp"
 
+#include <linux/i2c.h>
+
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct ButtonConfig;
+class ButtonIface;
+
+/**
+ * @brief turns the value of a cpld register into the value of a button,
+ * from the optional keys of its definition:
+ * - "format": how the sysfs attribute is written, "decimal" (default), "hex"
+ *   with or without 0x, or "raw" for a binary byte. A register read through
+ *   i2c-dev is always raw.
+ * - "mask": bits of the register that belong to the button, 0xff by default
+ * - "shift": right shift of the masked bits, by default the lowest bit of
+ *   the mask
+ * - "value_map": values of the button, e.g. host selector positions, by
+ *   shifted value such as { "0": 1, "0x3": 2 }. The values it doesn't list
+ *   are invalid.
+ * The spec is compiled once into a table indexed by the register value, so
+ * a register is decoded with a single lookup. Several buttons can take
+ * their own bits of the same register.
+ */
+class CpldDecoder
+{
+  public:
+    enum class Format
+    {
+        decimal,
+        hex,
+        raw
+    };
+
+    // value of a register the spec has no value for
+    static constexpr uint16_t invalidValue =
+        std::numeric_limits<uint16_t>::max();
+
+    // a "value_map" entry, shifted register value to value of the button
+    using ValueMapping = std::pair<uint16_t, uint16_t>;
+
+    // the whole register, as a decimal attribute
+    constexpr CpldDecoder() : CpldDecoder(Format::decimal, 0xff, 0, std::nullopt)
+    {}
+
+    explicit CpldDecoder(const nlohmann::json& config);
+
+    /**
+     * @brief compiles a checked spec, at build time for a spec known then
+     * @param[in] mask - not 0
+     * @param[in] shift - 0 to 7
+     * @param[in] valueMap - std::nullopt for the identity
+     */
+    constexpr CpldDecoder(
+        Format format, uint8_t mask, int shift,
+        std::optional<std::span<const ValueMapping>> valueMap) : format(format)
+    {
+        for (size_t value = 0; value < table.size(); value++)
+        {
+            uint16_t shifted = (value & mask) >> shift;
+            table[value] = shifted;
+            if (valueMap)
+            {
+                table[value] = invalidValue;
+                for (const auto& [key, mapped] : *valueMap)
+                {
+                    if (key == shifted)
+                    {
+                        table[value] = mapped;
+                    }
+                }
+            }
+        }
+    }
+
+    // false for a decoder mapped from a cache that doesn't hold one
+    constexpr bool isValid() const
+    {
+        return (format == Format::decimal) || (format == Format::hex) ||
+               (format == Format::raw);
+    }
+
+    constexpr uint16_t decode(uint8_t registerValue) const
+    {
+        return table[registerValue];
+    }
+
+    /**
+     * @brief reads and decodes the sysfs attribute behind fd
+     * @return the value, invalidValue when the attribute doesn't hold a
+     * register value, or std::nullopt on a read error
+     */
+    std::optional<uint16_t> read(int fd) const;
+
+  private:
+    Format format = Format::decimal;
+    std::array<uint16_t, 256> table{};
+};
+
+// state of a button from its decoded value, 0 is asserted
+constexpr GpioState toCpldState(uint16_t value)
+{
+    return (value == 0) ? GpioState::assert : GpioState::deassert;
+}
 
 struct CpldInfo
 {
     std::string registerName;
     uint32_t i2cAddress;
     uint32_t i2cBus;
-    int cpldMappedFd; // io fd mapped with the cpld
+    int cpldMappedFd = -1; // io fd mapped with the cpld
+    // register read through i2c-dev, the sysfs attribute registerName
+    // is read when not set
+    std::optional<uint8_t> registerOffset;
+    CpldDecoder decoder; // of the value of the button
 };
 
+/**
+ * @brief opens the sysfs attribute of a cpld register. A register read
+ * through i2c-dev has nothing to open per button, its device is opened by
+ * CpldDevices.
+ * @return int returns 0 on success, -1 on error
+ */
 int configCpld(ButtonConfig& buttonCfg);
+
+/**
+ * @brief the registers of an i2c device, read with a single I2C_RDWR
+ * transaction. The registers close to each other are read as one run, the
+ * write of its first register then a repeated start read. The runs of a
+ * regular file standing in for the adapter are read with pread.
+ */
+class CpldRegisters
+{
+  public:
+    struct Run
+    {
+        uint8_t first;
+        uint16_t count;
+    };
+
+    CpldRegisters() = default;
+    ~CpldRegisters();
+
+    // the messages point into the runs and the registers
+    CpldRegisters(const CpldRegisters&) = delete;
+    CpldRegisters& operator=(const CpldRegisters&) = delete;
+
+    /**
+     * @brief opens the device of an address
+     * @return int returns 0 on success, a negative errno on error
+     */
+    int open(const std::string& path, uint16_t address);
+
+    // groups the registers at offsets into the runs of a read
+    void plan(std::vector<uint8_t> offsets);
+
+    // reads the registers of every run, false on error
+    bool read();
+
+    uint8_t get(uint8_t offset) const
+    {
+        return registers[offset];
+    }
+
+    int getFd() const
+    {
+        return fd;
+    }
+
+    std::span<const Run> getRuns() const
+    {
+        return runs;
+    }
+
+  private:
+    int fd = -1;
+    uint16_t address = 0;
+    bool standIn = false; // a regular file instead of an i2c adapter
+    std::vector<Run> runs;
+    std::vector<i2c_msg> messages; // of the runs, built once
+    std::array<uint8_t, 256> registers{};
+};
+
+/**
+ * @brief reads the cpld registers that are accessed through i2c-dev. The
+ * registers of all the buttons on the same bus and address share one fd and
+ * are read with a single I2C_RDWR transaction per sample, whatever the
+ * number of buttons on them. The value of every button is then decoded and
+ * handed to it as an edge when it changed.
+ *
+ * i2c-dev gives no notification, so every device is sampled by the poll
+ * scheduler at the fastest rate of its buttons. A regular file can stand in
+ * for /dev/i2c-N, e.g. in I2C_DEV_DIR: register r of address a is then the
+ * byte at offset (a << 8) | r.
+ */
+class CpldDevices
+{
+  public:
+    static CpldDevices& instance()
+    {
+        static CpldDevices devices;
+        return devices;
+    }
+
+    /**
+     * @brief starts sampling the register of a button, the device is opened
+     * with the first button on it. The current value is read and kept,
+     * without being reported.
+     * @return int returns 0 on success, a negative errno on error
+     */
+    int add(const CpldInfo& cpld, std::chrono::milliseconds interval,
+            std::chrono::milliseconds maxInterval, ButtonIface& owner);
+
+    // stops sampling the register of a button, the last one closes the device
+    void remove(ButtonIface& owner);
+
+    // pauses or resumes a button, it resumes from the current value
+    void setEnabled(ButtonIface& owner, bool enabled);
+
+    // last decoded value of a button
+    std::optional<uint16_t> getValue(const ButtonIface& owner) const;
+
+  private:
+    CpldDevices() = default;
+
+    struct Subscriber
+    {
+        uint8_t offset;
+        const CpldDecoder* decoder; // in the config of the owner
+        ButtonIface* owner;
+        uint16_t value = 0; // last value handed to the owner
+        bool enabled = true;
+    };
+
+    struct Device
+    {
+        std::pair<uint32_t, uint32_t> key; // bus and address
+        std::string path;
+        std::optional<size_t> pollId;
+        std::chrono::milliseconds interval;
+        std::chrono::milliseconds maxInterval;
+        std::vector<Subscriber> subscribers;
+        CpldRegisters registers;
+    };
+
+    // groups the registers of the subscribers into the runs of a sample
+    static void plan(Device& device);
+    // samples a device and reports the changes, true when one changed
+    bool poll(Device& device);
+    void close(Device& device);
+
+    static uint16_t decode(const Device& device, const Subscriber& subscriber)
+    {
+        return subscriber.decoder->decode(
+            device.registers.get(subscriber.offset));
+    }
+
+    std::map<std::pair<uint32_t, uint32_t>, Device> devices;
+    // the device a poll is degrading the buttons of, erased after the poll
+    Device* polling = nullptr;
+};
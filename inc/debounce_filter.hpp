@@ -0,0 +1,55 @@
+#pragma once
+
+#include "gpio.hpp"
+#include "timer_wheel.hpp"
+
+#include <chrono>
+#include <functional>
+#include <span>
+#include <vector>
+
+/**
+ * @brief software debounce of the sysfs gpio and cpld lines of a button.
+ * Every edge restarts a settle timer and is held back. Once the lines have
+ * been quiet for the debounce period each of them is sampled again and only
+ * a state that differs from the last one reported is passed on.
+ */
+class DebounceFilter
+{
+  public:
+    // samples the line behind fd again, through filter()
+    using Resample = std::function<void(int fd)>;
+
+    DebounceFilter(std::chrono::milliseconds period, Resample resample);
+
+    // start filtering the line behind fd, in its initial state
+    void track(int fd, GpioState state);
+    // stop filtering all the lines, their fds are gone
+    void clear();
+
+    /**
+     * @brief filters the edges read from fd. The edges of a tracked line
+     * are held back until the lines settle, then the resampled state is
+     * returned if it changed. The edge reported carries the time of the
+     * last edge seen, which is when the contact stopped bouncing.
+     * @return the edges to handle, valid until the next call
+     */
+    std::span<const GpioEdge> filter(int fd, std::span<const GpioEdge> edges);
+
+  private:
+    struct Line
+    {
+        int fd;
+        GpioState state; // last state reported
+        std::chrono::steady_clock::time_point lastEdge;
+    };
+
+    void settled();
+
+    std::chrono::milliseconds period;
+    Resample resample;
+    TimerWheel::Timer timer;
+    std::vector<Line> lines;
+    bool resampling = false;
+    GpioEdge settledEdge{};
+};
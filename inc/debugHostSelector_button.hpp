@@ -30,7 +30,6 @@ class DebugHostSelector final :
         ButtonIface(bus, event, buttonCfg)
     {
         init();
-        emit_object_added();
     }
 
     ~DebugHostSelector()
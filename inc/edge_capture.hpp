@@ -0,0 +1,126 @@
+#pragma once
+
+#include "gpio.hpp"
+#include "spsc_ring.hpp"
+
+#include <systemd/sd-event.h>
+
+#include <atomic>
+#include <list>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class ButtonIface;
+
+/**
+ * @brief reads the button fds on a dedicated thread, so the time of an
+ * edge doesn't depend on how busy the D-Bus side of the event loop is.
+ * The thread waits on the fds, reads and timestamps the edges and queues
+ * them on a lock-free ring. The event loop is woken through an eventfd and
+ * hands the queued edges to the buttons.
+ */
+class EdgeCapture
+{
+  public:
+    static EdgeCapture& instance()
+    {
+        static EdgeCapture capture;
+        return capture;
+    }
+
+    /**
+     * @brief starts capturing the edges of fd for a button. gpio is the
+     * line behind a gpio fd, std::nullopt for a cpld register, whose values
+     * are read through decoder. The thread is started on the first call,
+     * and again after it stopped on an error.
+     * @return int returns 0 on success, a negative errno on error
+     */
+    int add(sd_event* event, int fd, uint32_t events,
+            const std::optional<GpioInfo>& gpio, const CpldDecoder* decoder,
+            ButtonIface& owner);
+
+    /**
+     * @brief stops capturing the fds of a button and takes them over. The
+     * thread may still be handling an event it took for them: the files are
+     * released right away, but the fd numbers are only closed once the thread
+     * acknowledged the removal through the event loop, so it never reads an
+     * fd that was reused by another open meanwhile.
+     */
+    void remove(ButtonIface& owner, std::vector<int> fds);
+
+    // pauses or resumes capturing the fds of a button, they stay open
+    void setEnabled(ButtonIface& owner, bool enabled);
+
+    ~EdgeCapture();
+
+  private:
+    EdgeCapture() = default;
+
+    struct Source
+    {
+        int fd;
+        uint32_t events;
+        std::optional<GpioInfo> gpio;
+        const CpldDecoder* decoder; // in the config of the owner
+        ButtonIface& owner;
+        // event loop side: the removal request the thread has to acknowledge
+        // before the source is erased
+        uint64_t removedBy = 0;
+        std::atomic<bool> active = true;
+        std::atomic<bool> enabled = true;
+        // edges of the source were dropped on a full ring
+        std::atomic<bool> overflowed = false;
+        // event loop side: last state handed to the owner, and time of the
+        // last resample, the edges queued before it are stale
+        GpioState lastState = GpioState::invalid;
+        std::chrono::steady_clock::time_point resampledAt{};
+    };
+
+    // an edge with GpioState::invalid reports a read error
+    struct CapturedEdge
+    {
+        Source* source;
+        GpioEdge edge;
+    };
+
+    int start(sd_event* event);
+    // starts the thread on a new epoll set
+    int startThread();
+    // returns false when epoll failed
+    bool run(std::stop_token stop);
+    // event loop side, hands the queued edges to the buttons
+    static int dispatch(sd_event_source* es, int fd, uint32_t revents,
+                        void* userdata);
+    // reads the line of a source whose edges were dropped, and hands its
+    // state to the owner when it changed
+    void resample(Source& source);
+    // closes the fds and erases the sources of the removals the thread
+    // acknowledged, once no queued edge points to them
+    void eraseRemoved();
+    // takes the buttons of a stopped thread out of service, their recovery
+    // starts it again
+    void degradeAll();
+
+    // the thread keeps pointers to the sources it waits on, a source is
+    // only erased once the thread acknowledged its removal
+    std::list<Source> sources;
+    SpscRing<CapturedEdge, 256> ring;
+    std::atomic<size_t> dropped = 0;
+    int epollFd = -1;
+    int wakeFd = -1;   // wakes the thread to stop or to acknowledge
+    int notifyFd = -1; // wakes the event loop
+    int nullFd = -1;   // takes the place of a removed fd until it is closed
+    GpioLineReader reader; // event loop side
+    bool dispatching = false;
+
+    // removals acknowledged by the thread, once back out of its batch
+    std::atomic<uint64_t> removalRequests = 0;
+    std::atomic<uint64_t> removalsDone = 0;
+    std::atomic<bool> running = false;
+    std::atomic<bool> failed = false; // the thread stopped on an error
+    // event loop side: the fds of the removals, with their request
+    std::vector<std::pair<uint64_t, int>> closing;
+
+    std::jthread thread;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "button_config.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief keeps the configured gpio and cpld fds of the buttons in the
+ * systemd fd store of the service. After a restart the daemon adopts them
+ * instead of configuring the lines again, and the lines keep their state
+ * in between. The fds are named after the button and a hash of its json
+ * definition, so a changed definition is configured from scratch.
+ * Outside of systemd there is no fd store and nothing is adopted.
+ */
+class FdStore
+{
+  public:
+    static FdStore& instance()
+    {
+        static FdStore fdStore;
+        return fdStore;
+    }
+
+    // name prefix of the stored fds of a button definition
+    static std::string getKey(const std::string& formFactorName,
+                              const nlohmann::json& definition);
+
+    // the same, for a definition identified by a string that changes with it
+    static std::string getKey(const std::string& formFactorName,
+                              std::string_view definitionId);
+
+    /**
+     * @brief hands the fds passed in for the key of a button to its config,
+     * the same way configuring its lines would have set them.
+     * @return true when the button was adopted
+     */
+    bool adopt(ButtonConfig& buttonCfg);
+
+    // closes and drops from the store the passed fds no button adopted
+    void releaseUnused();
+
+    // stores the fds of a configured button
+    void store(const ButtonConfig& buttonCfg);
+
+    // drops the stored fds of a button whose lines are going away
+    void remove(const ButtonConfig& buttonCfg);
+
+  private:
+    FdStore();
+
+    // fds passed in by systemd, by name
+    std::map<std::string, int> passedFds;
+    // number of fds stored for each key
+    std::unordered_map<std::string, size_t> storedCounts;
+    // FileDescriptorStoreMax, when systemd passes it, and whether the stored
+    // fds are over it, logged once each time they go over
+    std::optional<size_t> storeMax;
+    bool overLimit = false;
+};
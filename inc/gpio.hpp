@@ -15,13 +15,22 @@
 */
 #pragma once
 
+#include "config.hpp"
+
 #include <nlohmann/json.hpp>
 #include <sdbusplus/bus.hpp>
 
+#include <array>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 struct ButtonConfig;
+class CpldDecoder;
 
 // enum to represent gpio states
 enum class GpioState
@@ -37,20 +46,147 @@ enum class GpioPolarity
     activeHigh
 };
 
-struct GPIOBufferValue
+/**
+ * @brief gpio state of a raw line level, indexed by polarity then level.
+ * A constant table, so decoding an edge is a plain array lookup.
+ */
+constexpr std::array<std::array<GpioState, 2>, 2> gpioStateTable{{
+    {GpioState::assert, GpioState::deassert}, // activeLow
+    {GpioState::deassert, GpioState::assert}, // activeHigh
+}};
+
+// Get the gpio state of a raw level (0 or 1) based on polarity
+constexpr GpioState toGpioState(GpioPolarity polarity, uint8_t value)
 {
-    char assert;
-    char deassert;
-};
+    return gpioStateTable[static_cast<size_t>(polarity)][value & 1];
+}
+
+// Get the raw level (0 or 1) that puts a gpio in the given state
+constexpr uint8_t toGpioLevel(GpioPolarity polarity, GpioState state)
+{
+    return (toGpioState(polarity, 1) == state) ? 1 : 0;
+}
+
+// chipId of a gpio that is not on any known gpiochip
+constexpr unsigned invalidGpioChip = std::numeric_limits<unsigned>::max();
 
 // this struct has the gpio config for single gpio
 struct GpioInfo
 {
-    int fd; // io fd mapped with the gpio
+    int fd = -1; // io fd mapped with the gpio
     uint32_t number;
     std::string name;
     std::string direction;
-    GpioPolarity polarity;
+    GpioPolarity polarity = GpioPolarity::activeLow;
+    unsigned chipId = invalidGpioChip; // N of /dev/gpiochipN
+    uint32_t offset; // line offset on chipId
+    uint32_t requestIndex; // index of the line in the line request behind fd
+};
+
+// a gpiochip of the system
+struct GpioChipInfo
+{
+    std::optional<uint32_t> base; // global number of line 0, sysfs only
+    uint32_t ngpio;
+    unsigned chipId;     // N of /dev/gpiochipN
+    std::string devPath; // the gpiochip character device
+};
+
+// a line of a gpiochip named by gpio-line-names
+struct GpioLine
+{
+    const GpioChipInfo* chip;
+    uint32_t offset;
+};
+
+/**
+ * @brief index of the gpiochips by label. It is built once, on first use,
+ * from /sys/class/gpio and the /dev/gpiochipN character devices.
+ * The line names are only indexed on the first findLine() call.
+ */
+class GpioChipIndex
+{
+  public:
+    static const GpioChipIndex& instance()
+    {
+        static GpioChipIndex chipIndex;
+        return chipIndex;
+    }
+
+    // find the chip with the given label
+    const GpioChipInfo* find(const std::string& label) const;
+    // find the chip holding a global sysfs gpio number
+    const GpioChipInfo* find(uint32_t number) const;
+    // find the line with the given gpio-line-names entry
+    const GpioLine* findLine(const std::string& name) const;
+
+    // kernel build, and labels, sizes, chip numbers and bases of all the
+    // chips, a firmware update or a layout change drops the caches
+    std::string getChipsKey() const;
+
+  private:
+    GpioChipIndex();
+
+    /**
+     * @brief fills lines from the cache file when it was written for the
+     * same chips, otherwise reads the name of every line and rewrites it.
+     */
+    void indexLines() const;
+
+    std::unordered_map<std::string, GpioChipInfo> chips;
+    mutable std::optional<std::unordered_map<std::string, GpioLine>> lines;
+};
+
+// a single level change of a gpio line
+struct GpioEdge
+{
+    GpioState state; // state of the gpio after the edge, based on polarity
+    std::chrono::steady_clock::time_point time;
+};
+
+// max number of edges drained from a line by one GpioLineReader::read()
+constexpr size_t maxGpioEdges = 16;
+
+/**
+ * @brief reads the edges of configured gpios into a fixed buffer, so the
+ * event handlers of the buttons share one read path that doesn't allocate.
+ * A sysfs value is sampled with a single pread() and every edge is decoded
+ * through the polarity of the gpio.
+ */
+class GpioLineReader
+{
+  public:
+    using Edges = std::optional<std::span<const GpioEdge>>;
+
+    /**
+     * @brief reads the edges queued on the fd of a configured gpio.
+     * With gpio-chardev all queued line events are drained with one read()
+     * and carry the kernel timestamp of the edge, otherwise the current
+     * sysfs value is returned as a single edge timestamped now.
+     * @return the edges read, valid until the next call, or std::nullopt
+     * on a read error
+     */
+    Edges read(const GpioInfo& gpio);
+
+    /**
+     * @brief samples a sysfs style '0'/'1' attribute, such as the value of
+     * a sysfs gpio, as a single edge timestamped now.
+     * @return the edge read, valid until the next call, or std::nullopt on
+     * a read error
+     */
+    Edges readValue(int fd, GpioPolarity polarity);
+
+    /**
+     * @brief samples the sysfs attribute of a cpld register, decoded by the
+     * spec of its button, as a single edge timestamped now. A value the
+     * spec doesn't know gives no edge.
+     * @return the edge read, valid until the next call, or std::nullopt on
+     * a read error
+     */
+    Edges readCpld(int fd, const CpldDecoder& decoder);
+
+  private:
+    std::array<GpioEdge, maxGpioEdges> edges;
 };
 
 /**
@@ -62,6 +198,14 @@ struct GpioInfo
 
 int configGroupGpio(ButtonConfig& buttonCfg);
 
+/**
+ * @brief sets the fds of already configured gpios, such as the ones kept in
+ * the fd store, in the order configGroupGpio would have stored them: one
+ * per gpio with sysfs, one per gpiochip line request with gpio-chardev.
+ * @return int returns 0 on success, -1 when the fds don't match the gpios
+ */
+int adoptGroupGpio(ButtonConfig& buttonCfg, std::span<const int> fds);
+
 /**
  * @brief  configures and initializes the single gpio
  * @return int returns 0 on successful config of all gpios
@@ -69,11 +213,55 @@ int configGroupGpio(ButtonConfig& buttonCfg);
 
 int configGpio(GpioInfo& gpioConfig, ButtonConfig& buttonIFConfig);
 
-uint32_t getGpioNum(const std::string& gpioPin);
+uint32_t getGpioNum(const std::string& gpioPin,
+                    const std::string& chipLabel = GPIO_BASE_LABEL_NAME);
+
+// where the gpio of a config entry is, as far as known without the gpiochips
+struct GpioSpec
+{
+    std::string_view lineName;         // device tree name of the line
+    std::string_view chipLabel;        // chip of pinOffset
+    std::optional<uint32_t> pinOffset; // of an aspeed pin name on chipLabel
+    uint32_t number = 0;               // global number, without the above
+};
+
+/**
+ * @brief resolves a gpio to its global number and gpiochip line
+ * @return false when the line name is not found
+ */
+bool resolveGpio(GpioInfo& gpio, const GpioSpec& spec);
+
+/**
+ * @brief resolves the gpio of a json config entry. The gpio is given either
+ * by its device tree "line_name", by "pin", on the chip named by the
+ * optional "chip_label", or by its global "num".
+ * @return false when the line name is not found
+ */
+bool resolveGpio(GpioInfo& gpio, const nlohmann::json& gpioConfig);
+
+// Get the raw level (0 or 1) of a configured gpio, -1 on error
+int readGpioValue(const GpioInfo& gpio);
 // Set gpio state based on polarity
-void setGpioState(int fd, GpioPolarity polarity, GpioState state);
+void setGpioState(const GpioInfo& gpio, GpioState state);
 // Get gpio state based on polarity
-GpioState getGpioState(int fd, GpioPolarity polarity);
+GpioState getGpioState(const GpioInfo& gpio);
+
+/**
+ * @brief sets the state of several gpios based on their polarity.
+ * With gpio-chardev the lines sharing a line request are set with a
+ * single ioctl. Lines with GpioState::invalid are left untouched.
+ */
+void setGroupGpioState(std::span<const GpioInfo> gpios,
+                       std::span<const GpioState> states);
+
+/**
+ * @brief reads the raw level (0 or 1) of several gpios.
+ * With gpio-chardev the lines sharing a line request are sampled with a
+ * single ioctl, so a group can't be read in the middle of a transition.
+ * @return int returns 0 on success, -1 on error
+ */
+int readGroupGpioValues(std::span<const GpioInfo> gpios,
+                        std::span<uint8_t> values);
 
 // global json object which holds gpio_defs.json configs
 extern nlohmann::json gpioDefs;
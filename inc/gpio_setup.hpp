@@ -0,0 +1,17 @@
+#pragma once
+
+#include "button_config.hpp"
+
+#include <span>
+
+/**
+ * @brief configures the sysfs gpios of all the given buttons in one pass.
+ * A snapshot of the already exported gpios is taken first, the missing
+ * ones are exported, then direction and edge are set concurrently while
+ * skipping the writes that match the current configuration.
+ * The fd of each configured gpio is stored the same way configGpio does,
+ * so the configGroupGpio call of the button only handles what is left.
+ * Does nothing with gpio-chardev, where a line request is a single ioctl.
+ * @return int returns the number of gpios that could not be configured
+ */
+int configGpios(std::span<ButtonConfig> buttonConfigs);
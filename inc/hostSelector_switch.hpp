@@ -9,19 +9,15 @@
 
 #include <unistd.h>
 
-#include <nlohmann/json.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <sdeventplus/event.hpp>
-#include <sdeventplus/utility/timer.hpp>
 
 #include <chrono>
 #include <fstream>
 #include <iostream>
 #include <optional>
 
-using sdeventplus::ClockId;
 using sdeventplus::Event;
-using Timer = sdeventplus::utility::Timer<ClockId::Monotonic>;
 
 static constexpr auto HOST_SELECTOR = "HOST_SELECTOR";
 
@@ -42,16 +38,13 @@ class HostSelector final :
         ButtonIface(bus, event, buttonCfg)
     {
         init();
-        // read and store the host selector position Map
         if (buttonCfg.type == ConfigType::gpio)
         {
-            hsPosMap = buttonCfg.extraJsonInfo.at("host_selector_map")
-                           .get<std::map<std::string, int>>();
             gpioLineCount = buttonCfg.gpios.size();
+            gpioValues.resize(gpioLineCount);
         }
         setInitialHostSelectorValue();
-        maxPosition(buttonCfg.extraJsonInfo["max_position"], true);
-        emit_object_added();
+        maxPosition(buttonCfg.hostSelector.maxPosition, true);
     }
 
     ~HostSelector()
@@ -72,19 +65,32 @@ class HostSelector final :
     size_t getMappedHSConfig(size_t hsPosition);
     size_t getGpioIndex(int fd);
     void setInitialHostSelectorValue(void);
-    void setHostSelectorValue(int fd, GpioState state);
-    char getValueFromFd(int fd);
-    void pollGpioState();
-
-  private:
-    std::optional<Timer> pollTimer;
+    // reads the position, signalling it when skipSignal is false
+    void updateHostSelectorValue(bool skipSignal);
+    void readHostSelectorGpios();
+    void setHostSelectorValue(size_t pos, GpioState state);
+    // position held by the cpld register of the button
+    size_t readCpldPosition(int fd);
 
   protected:
+    // the selector may have moved while the button was gated off
+    void resumed() override
+    {
+        updateHostSelectorValue(false);
+    }
+
+    /**
+     * @brief samples the whole selector at once, so a poll never reports
+     * the position of a selector halfway through a transition.
+     */
+    bool poll() override;
+
     size_t hostSelectorPosition = 0;
     size_t gpioLineCount;
     size_t previousPos = INVALID_INDEX;
+    std::vector<uint8_t> gpioValues;
 
     // map of read Host selector switch value and corresponding host number
-    // value.
-    std::map<std::string, int> hsPosMap;
+    // value, in the config of the button.
+    std::map<std::string, int>& hsPosMap = config.hostSelector.positionMap;
 };
@@ -1,9 +1,8 @@
 #pragma once
 #include "power_button_profile.hpp"
+#include "timer_wheel.hpp"
 
 #include <sdbusplus/bus/match.hpp>
-#include <sdeventplus/event.hpp>
-#include <sdeventplus/utility/timer.hpp>
 #include <xyz/openbmc_project/State/Host/server.hpp>
 
 #include <chrono>
@@ -50,12 +49,8 @@ class HostThenChassisPowerOff : public PowerButtonProfile
      */
     explicit HostThenChassisPowerOff(sdbusplus::bus_t& bus) :
         PowerButtonProfile(bus), state(PowerOpState::buttonNotPressed),
-        timer(bus.get_event(),
-              std::bind(&HostThenChassisPowerOff::timerHandler, this),
-              pollInterval)
-    {
-        timer.setEnabled(false);
-    }
+        timer(std::bind(&HostThenChassisPowerOff::timerHandler, this))
+    {}
 
     /**
      * @brief Returns the name that matches the value in
@@ -178,8 +173,8 @@ class HostThenChassisPowerOff : public PowerButtonProfile
     std::chrono::time_point<std::chrono::steady_clock> chassisOffTime;
 
     /**
-     * @brief The timer object.
+     * @brief The timer object, on the timer wheel of the daemon.
      */
-    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> timer;
+    TimerWheel::Timer timer;
 };
 } // namespace phosphor::button
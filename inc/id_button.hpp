@@ -39,7 +39,7 @@ class IDButton :
              ButtonConfig& buttonCfg) :
         sdbusplus::server::object_t<
             sdbusplus::xyz::openbmc_project::Chassis::Buttons::server::ID>(
-            bus, path),
+            bus, path, action::defer_emit),
         ButtonIface(bus, event, buttonCfg)
     {
         init();
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "gpio.hpp"
+
+#include <systemd/sd-event.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct ButtonConfig;
+class ButtonIface;
+
+struct InputInfo
+{
+    std::string device; // event device path, or name of the input device
+    std::string path;   // resolved /dev/input/eventN path
+    uint16_t keyCode;   // EV_KEY code of the button
+    int fd = -1;        // fd of the device, shared and owned by InputDevices
+};
+
+/**
+ * @brief resolves the event device of an input button, a device given by
+ * name such as "gpio-keys" is looked up in /sys/class/input.
+ * @return int returns 0 on success, -1 when the device is not found
+ */
+int configInput(ButtonConfig& buttonCfg);
+
+/**
+ * @brief reads the input devices of the buttons, such as the gpio-keys
+ * driver. Every device is opened once and read in batches of input_event,
+ * whatever the number of buttons on it, and its EV_KEY events are handed to
+ * the button of the key code as edges carrying the kernel timestamp.
+ */
+class InputDevices
+{
+  public:
+    static InputDevices& instance()
+    {
+        static InputDevices devices;
+        return devices;
+    }
+
+    /**
+     * @brief starts reading the key of an input button, the device is
+     * opened and added to the event loop with the first button on it.
+     * Sets the fd of input.
+     * @return int returns 0 on success, a negative errno on error
+     */
+    int add(sd_event* event, InputInfo& input, int64_t priority,
+            ButtonIface& owner);
+
+    // stops reading the key of a button, the last one closes the device
+    void remove(ButtonIface& owner);
+
+    /**
+     * @brief pauses or resumes the key of a button. A device with no
+     * enabled key is not read, the events it queued meanwhile are dropped
+     * when it is resumed.
+     */
+    void setEnabled(ButtonIface& owner, bool enabled);
+
+  private:
+    InputDevices() = default;
+
+    struct Subscriber
+    {
+        uint16_t keyCode;
+        ButtonIface* owner;
+        GpioState state; // last state handed to the owner
+        bool enabled = true;
+    };
+
+    struct Device
+    {
+        std::string path;
+        int fd = -1;
+        sd_event_source* source = nullptr;
+        int64_t priority;
+        bool dropped = false; // events lost until the next SYN_REPORT
+        std::vector<Subscriber> subscribers;
+    };
+
+    static int dispatch(sd_event_source* es, int fd, uint32_t revents,
+                        void* userdata);
+    void read(Device& device);
+    // states of the keys read back after the kernel dropped events
+    void resync(Device& device, std::chrono::steady_clock::time_point now);
+    void close(Device& device);
+    // sets the states of the keys of owner, or of all the keys, without
+    // reporting them
+    void readKeys(Device& device, const ButtonIface* owner);
+
+    std::map<std::string, Device> devices;
+    // edges of the current batch, per subscriber of the device
+    std::vector<std::vector<GpioEdge>> pending;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief the gpio and cpld lines of all the buttons, in flat arrays indexed
+ * by a small integer handle: fd, owner and index of the line in its button.
+ * The handle of the line behind an fd is found with a direct lookup, so the
+ * cost of an edge doesn't depend on the number of lines. Lines sharing an fd, the lines of a gpio-chardev line
+ * request, are found through the first of them still registered.
+ */
+class LineRegistry
+{
+  public:
+    using Handle = uint32_t;
+    // the button of a line, only compared, so the registry doesn't depend
+    // on the buttons
+    using Owner = const void*;
+    static constexpr Handle invalidHandle = std::numeric_limits<Handle>::max();
+
+    static LineRegistry& instance()
+    {
+        static LineRegistry registry;
+        return registry;
+    }
+
+    /**
+     * @brief registers line index of a button, read through fd
+     * @return the handle of the line, invalidHandle when fd isn't open
+     */
+    Handle add(int fd, Owner owner, uint32_t index);
+
+    // unregisters a line, the other lines on its fd are still found through
+    // it, an invalid handle is ignored
+    void remove(Handle handle);
+
+    // the first line still registered on fd, or invalidHandle
+    Handle find(int fd) const
+    {
+        return ((fd >= 0) && (static_cast<size_t>(fd) < byFd.size()))
+                   ? byFd[fd]
+                   : invalidHandle;
+    }
+
+    Owner getOwner(Handle handle) const
+    {
+        return owners[handle];
+    }
+
+    uint32_t getIndex(Handle handle) const
+    {
+        return indexes[handle];
+    }
+
+  private:
+    LineRegistry() = default;
+
+    std::vector<int> fds; // -1 for a removed line
+    std::vector<Owner> owners;
+    std::vector<uint32_t> indexes;
+
+    std::vector<Handle> freeHandles; // handles of removed lines, reused
+    std::vector<Handle> byFd;        // handle of the first line, by fd
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "button_config.hpp"
+#include "cpld.hpp"
+#include "gpio.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief the button definitions of a platform, compiled into the buttons
+ * daemon from its gpio_defs.json with the 'platform-gpio-defs' meson option.
+ * scripts/gen_platform_tables.py generates them in platform_buttons.hpp as
+ * constexpr tables, in the order the buttons are created. What can be known
+ * without the hardware is resolved at build time: the pin offsets and the
+ * cpld decode tables. The line names, chip labels and the defaults that
+ * depend on the form factor are still resolved at start.
+ */
+namespace platform
+{
+
+// a gpio of a gpio definition, or of its "group_gpio_config"
+struct Gpio
+{
+    std::string_view name; // of a gpio of a group
+    std::string_view direction;
+    GpioPolarity polarity = GpioPolarity::activeLow;
+    GpioSpec spec;
+};
+
+// a "host_selector_map" entry, gpio values to host position
+using HostSelectorEntry = std::pair<std::string_view, int>;
+// a "serial_uart_mux_map" entry, host position to mux value
+using SerialUartMuxEntry = std::pair<size_t, size_t>;
+
+struct Button
+{
+    ConfigType type;
+    std::string_view name;
+    // hash of the definition, names the fds of the button in the fd store
+    std::string_view id;
+    uint32_t debounceMs = 0;
+    std::string_view priority; // empty for the default of the form factor
+    PollingInfo polling;
+    std::string_view presenceObject;
+    std::string_view presenceDefault;
+    std::string_view powerState;
+    std::string_view powerStateObject;
+
+    std::span<const Gpio> gpios;
+
+    std::string_view registerName;
+    std::optional<uint8_t> registerOffset;
+    uint32_t i2cAddress = 0;
+    uint32_t i2cBus = 0;
+    const CpldDecoder* decoder = nullptr; // of a cpld definition
+
+    std::string_view device; // of an input definition
+    std::optional<uint16_t> keyCode;
+
+    std::span<const HostSelectorEntry> hostSelectorMap;
+    size_t maxPosition = 0;
+    std::span<const SerialUartMuxEntry> serialUartMuxMap;
+};
+
+} // namespace platform
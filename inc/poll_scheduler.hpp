@@ -0,0 +1,63 @@
+#pragma once
+
+#include "timer_wheel.hpp"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief polls the inputs of the buttons that have no usable interrupt.
+ * All the polled buttons share a single timer. A button that reports no
+ * change has its interval doubled up to its maximum, a change brings it
+ * back to its minimum. The buttons due within the same tick are polled
+ * together, so they cost one wakeup.
+ */
+class PollScheduler
+{
+  public:
+    // samples the inputs of a button, returns true when one changed
+    using Poll = std::function<bool()>;
+
+    static PollScheduler& instance()
+    {
+        static PollScheduler scheduler;
+        return scheduler;
+    }
+
+    /**
+     * @brief adds a button to poll, starting at minInterval
+     * @return id to remove the button with
+     */
+    size_t add(std::chrono::milliseconds minInterval,
+               std::chrono::milliseconds maxInterval, Poll poll);
+
+    void remove(size_t id);
+
+    // pauses or resumes the polls of a button, resuming at minInterval
+    void setEnabled(size_t id, bool enabled);
+
+  private:
+    PollScheduler() = default;
+
+    struct Client
+    {
+        size_t id;
+        Poll poll;
+        std::chrono::milliseconds minInterval;
+        std::chrono::milliseconds maxInterval;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point due;
+        bool enabled = true;
+        bool removed = false; // by a poll, erased after the tick
+    };
+
+    // poll every client due now and rearm the timer
+    void tick();
+    void schedule();
+
+    std::vector<Client> clients;
+    TimerWheel::Timer timer{[this]() { tick(); }};
+    size_t nextId = 0;
+    bool ticking = false;
+};
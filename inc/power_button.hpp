@@ -41,7 +41,7 @@ class PowerButton :
                 ButtonConfig& buttonCfg) :
         sdbusplus::server::object_t<
             sdbusplus::xyz::openbmc_project::Chassis::Buttons::server::Power>(
-            bus, path),
+            bus, path, action::defer_emit),
         ButtonIface(bus, event, buttonCfg)
     {
         init();
@@ -63,7 +63,7 @@ class PowerButton :
     {
         return POWER_DBUS_OBJECT_NAME;
     }
-    void updatePressedTime();
+    void updatePressedTime(std::chrono::steady_clock::time_point time);
     auto getPressTime() const;
     void handleEvent(sd_event_source* es, int fd, uint32_t revents) override;
 
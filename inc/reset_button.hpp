@@ -39,7 +39,7 @@ class ResetButton :
                 ButtonConfig& buttonCfg) :
         sdbusplus::server::object_t<
             sdbusplus::xyz::openbmc_project::Chassis::Buttons::server::Reset>(
-            bus, path),
+            bus, path, action::defer_emit),
         ButtonIface(bus, event, buttonCfg)
     {
         init();
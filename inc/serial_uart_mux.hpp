@@ -26,30 +26,13 @@ class SerialUartMux final : public ButtonIface
     {
         init();
 
-        // read the platform specific config of host number to uart mux map
-        std::unordered_map<std::string, size_t> uartMuxMapJson =
-            buttonCfg.extraJsonInfo.at("serial_uart_mux_map")
-                .get<decltype(uartMuxMapJson)>();
-        for (auto& [key, value] : uartMuxMapJson)
-        {
-            auto index = std::stoi(key);
-            serialUartMuxMap[index] = value;
-        }
         if (buttonCfg.gpios.size() < 3)
         {
             throw std::runtime_error("not enough gpio configs found");
         }
 
-        for (auto& gpio : buttonCfg.gpios)
-        {
-            if (gpio.name == DEBUG_CARD_PRESENT_GPIO)
-            {
-                debugCardPresentGpio = gpio;
-                break;
-            }
-        }
-
         gpioLineCount = buttonCfg.gpios.size() - 1;
+        gpioStates.resize(gpioLineCount);
     }
 
     ~SerialUartMux()
@@ -75,6 +58,9 @@ class SerialUartMux final : public ButtonIface
   protected:
     size_t gpioLineCount;
     std::unique_ptr<sdbusplus::bus::match_t> hostPositionChanged;
-    GpioInfo debugCardPresentGpio;
-    std::unordered_map<size_t, size_t> serialUartMuxMap;
+    // the platform specific map of host number to uart mux value, in the
+    // config of the button
+    std::unordered_map<size_t, size_t>& serialUartMuxMap =
+        config.serialUartMux.muxMap;
+    std::vector<GpioState> gpioStates;
 };
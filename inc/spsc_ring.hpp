@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+/**
+ * @brief bounded lock-free ring for one producer thread and one consumer
+ * thread. push() fails instead of blocking when the ring is full.
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert((N > 0) && ((N & (N - 1)) == 0),
+                  "ring size must be a power of two");
+
+  public:
+    // producer side
+    bool push(const T& item)
+    {
+        auto tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - head.load(std::memory_order_acquire) == N)
+        {
+            return false;
+        }
+        items[tail % N] = item;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    std::optional<T> pop()
+    {
+        auto head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+        T item = items[head % N];
+        this->head.store(head + 1, std::memory_order_release);
+        return item;
+    }
+
+    // consumer side, true when nothing is queued
+    bool empty() const
+    {
+        return head.load(std::memory_order_relaxed) ==
+               tail.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T, N> items{};
+    // each index is written by one side only, keep them on their own
+    // cache lines
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+};
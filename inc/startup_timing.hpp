@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief the time the phases of the start of a daemon took, and the time
+ * each of its buttons took to be created, on the monotonic clock, so their
+ * start times are since boot. Once the daemon is ready the timings are
+ * logged and written as json to <daemon>-startup.json in the directory set
+ * by the 'startup-report-dir' meson option, then READY=1 is sent to
+ * systemd.
+ */
+class StartupTiming
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static StartupTiming& instance()
+    {
+        static StartupTiming timing;
+        return timing;
+    }
+
+    StartupTiming(const StartupTiming&) = delete;
+    StartupTiming& operator=(const StartupTiming&) = delete;
+
+    // ends the running phase, named name, the next one starts now
+    void phase(std::string_view name);
+
+    // records a button whose creation started at created
+    void button(std::string_view name, Clock::time_point created);
+
+    /**
+     * @brief reports the timings and notifies systemd that the daemon is
+     * ready. Nothing is recorded after.
+     */
+    void ready(std::string_view daemon);
+
+  private:
+    struct Entry
+    {
+        std::string name;
+        Clock::time_point start;
+        Clock::duration duration;
+    };
+
+    StartupTiming();
+
+    // writes the report to path, through a temporary file
+    void dump(const std::string& path, std::string_view daemon) const;
+
+    Clock::time_point start;      // of the first phase
+    Clock::time_point phaseStart; // of the running phase
+    std::vector<Entry> phases;
+    std::vector<Entry> buttons;
+    bool isReady = false;
+};
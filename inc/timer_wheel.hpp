@@ -0,0 +1,125 @@
+#pragma once
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+/**
+ * @brief the timers of a daemon, kept in a hierarchical timer wheel behind
+ * a single sd_event time source. The wheel has 4 levels of 64 slots with a
+ * 1ms tick, a level covering 64 times the span of the one below. A timer is
+ * linked in the slot of its expiry, so arming and cancelling it are O(1),
+ * and it moves down a level when the slot it waits in comes up. The time
+ * source is only armed for the next slot holding timers, so any number of
+ * per button deadlines costs one wakeup per expiry at most.
+ */
+class TimerWheel
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::milliseconds;
+
+    class Timer;
+
+    static TimerWheel& instance()
+    {
+        // never destroyed, the timers of other singletons may outlive it
+        static TimerWheel* wheel = new TimerWheel;
+        return *wheel;
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+  private:
+    static constexpr unsigned levelBits = 6;
+    static constexpr unsigned levelCount = 4;
+    static constexpr uint64_t slotCount = 1 << levelBits;
+    static constexpr uint64_t slotMask = slotCount - 1;
+    // ticks covered by the whole wheel, later expiries wait at the top
+    static constexpr uint64_t maxDelta =
+        (uint64_t(1) << (levelBits * levelCount)) - 1;
+
+    // link of a timer in a slot list, the lists are circular
+    struct Node
+    {
+        Node* prev = this;
+        Node* next = this;
+        Timer* timer = nullptr; // null for the head of a slot
+    };
+
+    struct Slot
+    {
+        Node head;
+        unsigned level;
+        unsigned index;
+    };
+
+    TimerWheel();
+
+    // first tick at or after time
+    uint64_t toTick(Clock::time_point time) const;
+    // last tick passed
+    uint64_t nowTick() const;
+    Clock::time_point toTime(uint64_t tick) const;
+
+    void insert(Timer& timer);
+    void unlink(Timer& timer);
+    // next tick with a slot to fire or to cascade, if any timer is armed
+    std::optional<uint64_t> nextTick() const;
+    // processes every tick up to now and rearms the time source
+    void expire();
+    // moves the timers of a slot down, as its tick has come
+    void cascade(Slot& slot);
+    void fire(Slot& slot);
+    void schedule();
+
+    using SourceTimer =
+        sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>;
+
+    Clock::time_point start;
+    uint64_t current = 0; // last tick processed
+    std::array<std::array<Slot, slotCount>, levelCount> slots;
+    std::array<uint64_t, levelCount> occupied{}; // non empty slots, by bit
+    SourceTimer source;
+};
+
+/**
+ * @brief a timer of the wheel, with the interface of the sdeventplus timer
+ * it replaces. Cancelled when destroyed.
+ */
+class TimerWheel::Timer
+{
+  public:
+    using Callback = std::function<void()>;
+
+    explicit Timer(Callback callback);
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    // fires once, after delay
+    void restartOnce(Duration delay);
+    // fires every interval, starting one interval from now
+    void restart(Duration interval);
+    // enabling rearms the timer for its interval, or to fire right away
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+  private:
+    friend class TimerWheel;
+
+    void arm(Duration delay);
+
+    Node node;
+    Slot* slot = nullptr; // slot linked in, null when not armed
+    uint64_t expiry = 0;
+    std::optional<Duration> interval;
+    Callback callback;
+};
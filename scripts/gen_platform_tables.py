@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+
+"""
+Generates the button tables of a platform from its gpio_defs.json, for the
+'platform-gpio-defs' meson option:
+- platform_buttons.hpp, the definitions served by the buttons daemon, see
+  inc/platform_tables.hpp
+- platform_multi_actions.hpp, the multi-action tables of the button handler
+
+An invalid definition fails the build, instead of being skipped at start.
+"""
+
+import argparse
+import hashlib
+import json
+import re
+import sys
+
+# in the order the buttons are created
+SECTIONS = [
+    ("cpld_definitions", "ConfigType::cpld"),
+    ("input_definitions", "ConfigType::input"),
+    ("gpio_definitions", "ConfigType::gpio"),
+]
+
+CPLD_FORMATS = {
+    "decimal": "CpldDecoder::Format::decimal",
+    "hex": "CpldDecoder::Format::hex",
+    "raw": "CpldDecoder::Format::raw",
+}
+
+CHASSIS_TRANSITIONS = {
+    "chassis-on": "Transition::On",
+    "chassis-off": "Transition::Off",
+    "chassis-cycle": "Transition::PowerCycle",
+}
+
+GPIO_BASE_LABEL_NAME = "1e780000.gpio"
+
+
+def quote(text):
+    return json.dumps(str(text), ensure_ascii=True)
+
+
+def pin_offset(pin):
+    """Offset of an aspeed pin name such as "AA3", as gpioplus computes it"""
+    if not re.fullmatch(r"[A-Z]+[0-7]", pin):
+        raise ValueError(f"invalid pin {pin}")
+    bank = 0
+    for letter in pin[:-1]:
+        bank = bank * 26 + ord(letter) - ord("A") + 1
+    return (bank - 1) * 8 + int(pin[-1])
+
+
+def gpio_spec(config):
+    if "line_name" in config:
+        return f".lineName = {quote(config['line_name'])}"
+    if "pin" in config:
+        label = config.get("chip_label", GPIO_BASE_LABEL_NAME)
+        return (
+            f".chipLabel = {quote(label)}, "
+            f".pinOffset = {pin_offset(config['pin'])}"
+        )
+    return f".number = {int(config['num'])}"
+
+
+def gpio(config, name=None):
+    fields = []
+    if name is not None:
+        fields.append(f".name = {quote(name)}")
+    fields.append(f".direction = {quote(config['direction'])}")
+    if config.get("polarity") == "active_high":
+        fields.append(".polarity = GpioPolarity::activeHigh")
+    fields.append(f".spec = {{{gpio_spec(config)}}}")
+    return "{" + ", ".join(fields) + "}"
+
+
+def milliseconds(value):
+    return f"std::chrono::milliseconds({int(value)})"
+
+
+class Generator:
+    def __init__(self):
+        self.tables = []  # the arrays the buttons point to
+        self.buttons = []
+
+    def table(self, name, type_name, entries):
+        self.tables.append(
+            f"inline constexpr std::array<{type_name}, {len(entries)}> "
+            f"{name}{{{{\n"
+            + "".join(f"    {entry},\n" for entry in entries)
+            + "}};\n"
+        )
+
+    def decoder(self, prefix, definition):
+        format_name = definition.get("format", "decimal")
+        if "register_offset" in definition:
+            format_name = "raw"
+        if format_name not in CPLD_FORMATS:
+            raise ValueError(f"unknown cpld value format {format_name}")
+
+        mask = int(definition.get("mask", 0xFF))
+        if not 0 < mask <= 0xFF:
+            raise ValueError(f"invalid cpld value mask {mask}")
+        lowest = (mask & -mask).bit_length() - 1
+        shift = min(max(int(definition.get("shift", lowest)), 0), 7)
+
+        value_map = "std::nullopt"
+        if "value_map" in definition:
+            mappings = {}
+            for key, value in definition["value_map"].items():
+                mappings[int(key, 0)] = int(value)
+            self.table(
+                f"{prefix}ValueMap",
+                "CpldDecoder::ValueMapping",
+                [f"{{{key}, {value}}}" for key, value in mappings.items()],
+            )
+            value_map = (
+                "std::span<const CpldDecoder::ValueMapping>"
+                f"({prefix}ValueMap)"
+            )
+
+        self.tables.append(
+            f"inline constexpr CpldDecoder {prefix}Decoder{{"
+            f"{CPLD_FORMATS[format_name]}, {mask:#04x}, {shift}, "
+            f"{value_map}}};\n"
+        )
+        return f"&{prefix}Decoder"
+
+    def button(self, type_name, definition):
+        prefix = f"button{len(self.buttons)}"
+        name = definition["name"]
+        # the definition changes with its id, so do the keys of its fds
+        canonical = json.dumps(
+            definition, sort_keys=True, separators=(",", ":")
+        )
+        definition_id = hashlib.sha256(canonical.encode()).hexdigest()[:16]
+
+        fields = [
+            f".type = {type_name}",
+            f".name = {quote(name)}",
+            f".id = {quote(definition_id)}",
+        ]
+        if "debounce_ms" in definition:
+            fields.append(f".debounceMs = {int(definition['debounce_ms'])}")
+        if "priority" in definition:
+            fields.append(f".priority = {quote(definition['priority'])}")
+
+        polling = []
+        if definition.get("polling_mode", False):
+            polling.append(".enabled = true")
+        if "polling_interval_ms" in definition:
+            interval = milliseconds(definition["polling_interval_ms"])
+            polling.append(f".interval = {interval}")
+        if "polling_max_interval_ms" in definition:
+            interval = milliseconds(definition["polling_max_interval_ms"])
+            polling.append(f".maxInterval = {interval}")
+        if polling:
+            fields.append(f".polling = {{{', '.join(polling)}}}")
+
+        for key, field in (
+            ("presence_object", "presenceObject"),
+            ("presence_default", "presenceDefault"),
+            ("power_state", "powerState"),
+            ("power_state_object", "powerStateObject"),
+        ):
+            if key in definition:
+                fields.append(f".{field} = {quote(definition[key])}")
+
+        if type_name == "ConfigType::gpio":
+            if "group_gpio_config" in definition:
+                gpios = [
+                    gpio(config, config["name"])
+                    for config in definition["group_gpio_config"]
+                ]
+            else:
+                gpios = [gpio(definition)]
+            self.table(f"{prefix}Gpios", "Gpio", gpios)
+            fields.append(f".gpios = {prefix}Gpios")
+        elif type_name == "ConfigType::cpld":
+            if "register_offset" in definition:
+                offset = int(definition["register_offset"])
+                fields.append(f".registerOffset = {offset}")
+            else:
+                register = definition["register_name"]
+                fields.append(f".registerName = {quote(register)}")
+            fields.append(f".i2cAddress = {int(definition['i2c_address'])}")
+            fields.append(f".i2cBus = {int(definition['i2c_bus'])}")
+            fields.append(f".decoder = {self.decoder(prefix, definition)}")
+        else:
+            if "device" in definition:
+                fields.append(f".device = {quote(definition['device'])}")
+            if "key_code" in definition:
+                fields.append(f".keyCode = {int(definition['key_code'])}")
+
+        if name == "HOST_SELECTOR":
+            if type_name == "ConfigType::gpio":
+                self.table(
+                    f"{prefix}HostSelectorMap",
+                    "HostSelectorEntry",
+                    [
+                        f"{{{quote(key)}, {int(value)}}}"
+                        for key, value in definition[
+                            "host_selector_map"
+                        ].items()
+                    ],
+                )
+                fields.append(f".hostSelectorMap = {prefix}HostSelectorMap")
+            fields.append(f".maxPosition = {int(definition['max_position'])}")
+        elif name == "SERIAL_UART_MUX":
+            self.table(
+                f"{prefix}SerialUartMuxMap",
+                "SerialUartMuxEntry",
+                [
+                    f"{{{int(key)}, {int(value)}}}"
+                    for key, value in definition["serial_uart_mux_map"].items()
+                ],
+            )
+            fields.append(f".serialUartMuxMap = {prefix}SerialUartMuxMap")
+
+        self.buttons.append("{" + ", ".join(fields) + "}")
+
+    def header(self, source):
+        return (
+            f"// Generated by gen_platform_tables.py from {source}, "
+            "do not edit.\n"
+            "#pragma once\n\n"
+            '#include "platform_tables.hpp"\n\n'
+            "#include <chrono>\n\n"
+            "namespace platform\n{\n\n"
+            # the fields a definition doesn't have keep their default
+            "#pragma GCC diagnostic push\n"
+            '#pragma GCC diagnostic ignored "-Wmissing-field-initializers"\n\n'
+            + "".join(self.tables)
+            + f"inline constexpr std::array<Button, {len(self.buttons)}> "
+            "buttons{{\n"
+            + "".join(f"    {button},\n" for button in self.buttons)
+            + "}};\n\n"
+            "#pragma GCC diagnostic pop\n\n"
+            "} // namespace platform\n"
+        )
+
+
+def multi_actions_header(source, definitions):
+    # a platform supports multi-actions when every gpio definition has them,
+    # the tables before the first one without are kept as the daemon does
+    supported = True
+    tables = []
+    for definition in definitions.get("gpio_definitions", []):
+        if "multi-action" not in definition:
+            supported = False
+            break
+
+        actions = {}
+        for action in definition["multi-action"]:
+            if action["action"] not in CHASSIS_TRANSITIONS:
+                raise ValueError(f"unknown power button action {action}")
+            actions[int(action["duration"])] = CHASSIS_TRANSITIONS[
+                action["action"]
+            ]
+        tables.append(
+            [
+                f"{{{duration}, {actions[duration]}}}"
+                for duration in sorted(actions)
+            ]
+        )
+
+    # the slots, one for each indexed power button the buttons daemon serves
+    slots = set()
+    for section, _ in SECTIONS:
+        for definition in definitions.get(section, []):
+            match = re.fullmatch(
+                r"POWER_BUTTON([1-9][0-9]*)", definition.get("name", "")
+            )
+            if match:
+                slots.add(int(match.group(1)))
+
+    text = (
+        f"// Generated by gen_platform_tables.py from {source}, "
+        "do not edit.\n"
+        "#pragma once\n\n"
+        "#include <xyz/openbmc_project/State/Chassis/server.hpp>\n\n"
+        "#include <array>\n"
+        "#include <cstddef>\n"
+        "#include <cstdint>\n"
+        "#include <span>\n"
+        "#include <utility>\n\n"
+        "namespace platform\n{\n\n"
+        "using Transition =\n"
+        "    sdbusplus::xyz::openbmc_project::State::server::Chassis::"
+        "Transition;\n"
+        "// chassis transition of a press longer than its duration in ms\n"
+        "using MultiAction = std::pair<uint16_t, Transition>;\n\n"
+        "inline constexpr bool multiActionSupported = "
+        f"{'true' if supported else 'false'};\n\n"
+        "// n of each POWER_BUTTON<n> definition, sorted\n"
+        f"inline constexpr std::array<size_t, {len(slots)}>\n"
+        "    powerButtonIndexes{{"
+        + ", ".join(str(slot) for slot in sorted(slots))
+        + "}};\n\n"
+    )
+    for index, actions in enumerate(tables):
+        text += (
+            f"inline constexpr std::array<MultiAction, {len(actions)}> "
+            f"multiActions{index}{{{{\n"
+            + "".join(f"    {action},\n" for action in actions)
+            + "}};\n"
+        )
+    text += (
+        "// of the power button of each host\n"
+        "inline constexpr std::array<std::span<const MultiAction>, "
+        f"{len(tables)}>\n"
+        "    multiActions{{"
+        + ", ".join(f"multiActions{index}" for index in range(len(tables)))
+        + "}};\n\n} // namespace platform\n"
+    )
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("gpio_defs", help="gpio_defs.json of the platform")
+    parser.add_argument("buttons", help="platform_buttons.hpp to generate")
+    parser.add_argument(
+        "multi_actions", help="platform_multi_actions.hpp to generate"
+    )
+    args = parser.parse_args()
+
+    with open(args.gpio_defs) as file:
+        definitions = json.load(file)
+    source = args.gpio_defs.rsplit("/", 1)[-1]
+
+    generator = Generator()
+    try:
+        for section, type_name in SECTIONS:
+            for definition in definitions.get(section, []):
+                generator.button(type_name, definition)
+        multi_actions = multi_actions_header(source, definitions)
+    except (KeyError, TypeError, ValueError) as e:
+        sys.exit(f"{args.gpio_defs}: invalid definition: {e!r}")
+
+    with open(args.buttons, "w") as file:
+        file.write(generator.header(source))
+    with open(args.multi_actions, "w") as file:
+        file.write(multi_actions)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+
+"""
+Generates a large gpio_defs.json shared with other daemons, to measure the
+start of the button daemons with scripts/measure_startup.sh:
+- an indexed power button with multi-actions for each slot, a reset and an
+  ID button, served by the buttons daemon
+- definitions of other daemons among them, skipped by the buttons daemon
+- sections of other daemons, not read at all
+
+The output only depends on the arguments, so runs on different images
+measure the same file. With -Dbenchmarks=enabled the build generates
+sample_gpio_defs.json with the defaults.
+"""
+
+import argparse
+import json
+
+# the pins of the buttons, on the gpiochip labeled 1e780000.gpio
+FIRST_BUTTON_PIN = 8
+
+
+def pin_name(offset):
+    """Aspeed pin name of an offset, the inverse of pin_offset() of
+    gen_platform_tables.py"""
+    bank = offset // 8 + 1
+    letters = ""
+    while bank > 0:
+        bank, letter = divmod(bank - 1, 26)
+        letters = chr(ord("A") + letter) + letters
+    return f"{letters}{offset % 8}"
+
+
+def buttons(slots):
+    pins = iter(range(FIRST_BUTTON_PIN, FIRST_BUTTON_PIN + slots + 2))
+    definitions = [
+        {
+            "name": f"POWER_BUTTON{slot}",
+            "pin": pin_name(next(pins)),
+            "direction": "both",
+            "multi-action": [
+                {"duration": 0, "action": "chassis-on"},
+                {"duration": 4000, "action": "chassis-cycle"},
+                {"duration": 8000, "action": "chassis-off"},
+            ],
+        }
+        for slot in range(1, slots + 1)
+    ]
+    for name in ("RESET_BUTTON", "ID_BTN"):
+        definitions.append(
+            {
+                "name": name,
+                "pin": pin_name(next(pins)),
+                "direction": "both",
+                "multi-action": [],
+            }
+        )
+    return definitions
+
+
+def foreign(count):
+    # other daemons name their lines, their pins don't clash with the
+    # buttons. An empty multi-action keeps the multi-action tables of the
+    # power buttons in use, the handler needs one for every definition
+    return [
+        {
+            "name": f"FM_SLOT{index // 16 + 1}_SIGNAL{index % 16}_N",
+            "line_name": f"FM_SLOT{index // 16 + 1}_SIGNAL{index % 16}_N",
+            "direction": "in",
+            "polarity": "active_low",
+            "description": "Monitored by another daemon, skipped by the "
+            "buttons daemon",
+            "multi-action": [],
+        }
+        for index in range(count)
+    ]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("output", help="gpio_defs.json to generate")
+    parser.add_argument(
+        "--slots", type=int, default=8, help="number of power buttons"
+    )
+    parser.add_argument(
+        "--foreign",
+        type=int,
+        default=256,
+        help="number of definitions of other daemons",
+    )
+    args = parser.parse_args()
+
+    definitions = {
+        "gpio_definitions": buttons(args.slots) + foreign(args.foreign),
+        "power_config": {
+            "gpio_configs": [
+                {
+                    "name": f"POWER_OUT{index}",
+                    "line_name": f"POWER_OUT{index}",
+                    "direction": "out",
+                }
+                for index in range(args.foreign // 4)
+            ]
+        },
+    }
+
+    with open(args.output, "w") as file:
+        json.dump(definitions, file, indent=4)
+        file.write("\n")
+
+
+if __name__ == "__main__":
+    main()
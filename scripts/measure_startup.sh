@@ -0,0 +1,109 @@
+#!/bin/sh
+#
+# Measures the start of the button daemons on a BMC: the time from exec to
+# READY=1 and the resident memory of each daemon once ready. The daemons are
+# restarted RUNS times and the median of each value is reported, so two
+# images can be compared with the same gpio_defs.json, e.g. the
+# sample_gpio_defs.json of a build with -Dbenchmarks=enabled, generated by
+# scripts/gen_sample_gpio_defs.py.
+#
+# usage: measure_startup.sh [-n RUNS] [-f GPIO_DEFS] [-c]
+#   -n RUNS       number of restarts, 5 by default
+#   -f GPIO_DEFS  gpio_defs.json to measure with, installed for the runs and
+#                 the original restored after
+#   -c            cold starts, the compiled definitions and the gpio line
+#                 names are dropped before each run
+#
+# CACHE_DIR and REPORT_DIR are the 'config-cache-dir' and
+# 'startup-report-dir' meson options of the image, when not the defaults.
+
+set -eu
+
+BUTTONS=xyz.openbmc_project.Chassis.Buttons.service
+HANDLER=phosphor-button-handler.service
+GPIO_DEFS=/etc/default/obmc/gpio/gpio_defs.json
+CACHE_DIR=${CACHE_DIR:-/var/cache/phosphor-buttons}
+REPORT_DIR=${REPORT_DIR:-/run/phosphor-buttons}
+
+runs=5
+defs=
+cold=0
+while getopts "n:f:c" opt; do
+    case $opt in
+        n) runs=$OPTARG ;;
+        f) defs=$OPTARG ;;
+        c) cold=1 ;;
+        *) sed -n '3,19s/^# \{0,1\}//p' "$0" >&2; exit 1 ;;
+    esac
+done
+
+restore() {
+    if [ -f "$GPIO_DEFS.measure" ]; then
+        mv "$GPIO_DEFS.measure" "$GPIO_DEFS"
+        systemctl restart "$BUTTONS" "$HANDLER"
+    fi
+}
+
+results=$(mktemp)
+trap 'rm -f "$results"; restore' EXIT INT TERM
+
+if [ -n "$defs" ]; then
+    cp "$GPIO_DEFS" "$GPIO_DEFS.measure"
+    cp "$defs" "$GPIO_DEFS"
+fi
+
+# field of the top level object of a startup report
+report_field() {
+    sed -n "s/^    \"$2\": \([0-9]*\).*/\1/p" "$REPORT_DIR/$1-startup.json"
+}
+
+# microseconds from exec to READY=1 as seen by systemd, and as seen by the
+# daemon from its first phase
+measure() {
+    unit=$1
+    daemon=$2
+
+    rm -f "$REPORT_DIR/$daemon-startup.json"
+    systemctl start "$unit"
+
+    exec_us=$(systemctl show --value \
+        -p ExecMainStartTimestampMonotonic "$unit")
+    active_us=$(systemctl show --value \
+        -p ActiveEnterTimestampMonotonic "$unit")
+    status=/proc/$(systemctl show --value -p MainPID "$unit")/status
+    rss_kb=$(sed -n 's/^VmRSS:[[:space:]]*\([0-9]*\) kB/\1/p' "$status")
+    hwm_kb=$(sed -n 's/^VmHWM:[[:space:]]*\([0-9]*\) kB/\1/p' "$status")
+    start_us=$(report_field "$daemon" start_us)
+    ready_us=$(report_field "$daemon" ready_us)
+
+    echo "$daemon $((active_us - exec_us)) $((ready_us - start_us))" \
+        "$rss_kb $hwm_kb"
+}
+
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+run=1
+while [ "$run" -le "$runs" ]; do
+    systemctl stop "$HANDLER" "$BUTTONS"
+    if [ "$cold" -eq 1 ]; then
+        rm -f "$CACHE_DIR"/*
+    fi
+    # the handler is started after the buttons are on D-Bus, as at boot
+    measure "$BUTTONS" buttons >> "$results"
+    measure "$HANDLER" button-handler >> "$results"
+    run=$((run + 1))
+done
+
+printf "%-16s %12s %12s %12s %12s\n" daemon exec_to_ready_us ready_us \
+    rss_kb hwm_kb
+for daemon in buttons button-handler; do
+    printf "%-16s" "$daemon"
+    for column in 2 3 4 5; do
+        value=$(awk -v d="$daemon" -v c="$column" '$1 == d { print $c }' \
+            "$results" | median)
+        printf " %12s" "$value"
+    done
+    printf "\n"
+done
@@ -0,0 +1,162 @@
+#include "bus_source.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <ctime>
+#include <system_error>
+
+BusSource::BusSource(sd_event* event, sd_bus* bus, int64_t priority) :
+    bus(bus)
+{
+    int fd = sd_bus_get_fd(bus);
+    int ret = fd;
+    if (ret >= 0)
+    {
+        ret = sd_event_add_io(event, &ioSource, fd, 0, io, this);
+    }
+    if (ret >= 0)
+    {
+        ret = sd_event_source_set_prepare(ioSource, prepare);
+    }
+    if (ret >= 0)
+    {
+        ret = sd_event_add_time(event, &timeSource, CLOCK_MONOTONIC, 0, 0,
+                                time, this);
+    }
+    if (ret >= 0)
+    {
+        ret = sd_event_add_defer(event, &resumeSource, resumeDispatch, this);
+    }
+    if (ret >= 0)
+    {
+        ret = sd_event_source_set_prepare(resumeSource, resumePrepare);
+    }
+    if (ret < 0)
+    {
+        sd_event_source_disable_unref(ioSource);
+        sd_event_source_disable_unref(timeSource);
+        sd_event_source_disable_unref(resumeSource);
+        throw std::system_error(-ret, std::generic_category(),
+                                "Failed to attach the bus");
+    }
+
+    sd_event_source_set_priority(ioSource, priority);
+    sd_event_source_set_priority(timeSource, priority);
+    sd_event_source_set_priority(resumeSource, SD_EVENT_PRIORITY_IDLE);
+    sd_event_source_set_enabled(timeSource, SD_EVENT_OFF);
+    sd_event_source_set_enabled(resumeSource, SD_EVENT_OFF);
+}
+
+BusSource::~BusSource()
+{
+    sd_event_source_disable_unref(ioSource);
+    sd_event_source_disable_unref(timeSource);
+    sd_event_source_disable_unref(resumeSource);
+}
+
+int BusSource::prepare(sd_event_source* /* es */, void* userdata)
+{
+    auto* source = static_cast<BusSource*>(userdata);
+
+    // a burst ends with an iteration that didn't dispatch the bus
+    if (!source->dispatched)
+    {
+        source->burst = 0;
+    }
+    source->dispatched = false;
+    source->arm();
+    return 0;
+}
+
+int BusSource::io(sd_event_source* /* es */, int /* fd */,
+                  uint32_t /* revents */, void* userdata)
+{
+    static_cast<BusSource*>(userdata)->process();
+    return 0;
+}
+
+int BusSource::time(sd_event_source* /* es */, uint64_t /* usec */,
+                    void* userdata)
+{
+    static_cast<BusSource*>(userdata)->process();
+    return 0;
+}
+
+int BusSource::resumePrepare(sd_event_source* /* es */, void* userdata)
+{
+    auto* source = static_cast<BusSource*>(userdata);
+
+    if (source->skipped)
+    {
+        source->resume();
+    }
+    else
+    {
+        source->skipped = true;
+    }
+    return 0;
+}
+
+int BusSource::resumeDispatch(sd_event_source* /* es */, void* userdata)
+{
+    static_cast<BusSource*>(userdata)->resume();
+    return 0;
+}
+
+void BusSource::arm()
+{
+    int events = sd_bus_get_events(bus);
+    if (events >= 0)
+    {
+        sd_event_source_set_io_events(ioSource, static_cast<uint32_t>(events));
+    }
+
+    // queued messages make the timeout now
+    uint64_t until = 0;
+    if (sd_bus_get_timeout(bus, &until) > 0)
+    {
+        sd_event_source_set_time(timeSource, until);
+        sd_event_source_set_enabled(timeSource, SD_EVENT_ONESHOT);
+    }
+    else
+    {
+        sd_event_source_set_enabled(timeSource, SD_EVENT_OFF);
+    }
+}
+
+void BusSource::process()
+{
+    int ret = sd_bus_process(bus, nullptr);
+    if (ret < 0)
+    {
+        // the daemon is of no use without its bus, systemd restarts it
+        lg2::error("Failed to process the bus: {ERROR}", "ERROR", ret);
+        sd_event_exit(sd_event_source_get_event(ioSource), ret);
+        return;
+    }
+
+    dispatched = true;
+    if (++burst >= maxBurst)
+    {
+        pause();
+    }
+}
+
+void BusSource::pause()
+{
+    sd_event_source_set_enabled(ioSource, SD_EVENT_OFF);
+    sd_event_source_set_enabled(timeSource, SD_EVENT_OFF);
+    skipped = false;
+    sd_event_source_set_enabled(resumeSource, SD_EVENT_ONESHOT);
+}
+
+void BusSource::resume()
+{
+    sd_event_source_set_enabled(resumeSource, SD_EVENT_OFF);
+    burst = 0;
+    dispatched = false;
+    sd_event_source_set_enabled(ioSource, SD_EVENT_ON);
+    // the prepare callback of the io source may have run already in this
+    // iteration, while it was off
+    arm();
+}
@@ -0,0 +1,535 @@
+#include "button_config.hpp"
+
+#include "button_factory.hpp"
+#include "config_cache.hpp"
+#include "fd_store.hpp"
+
+#include <linux/input-event-codes.h>
+
+#include <nlohmann/json.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <map>
+
+// the definitions of gpio_defs.json compiled by an earlier start
+const std::string definitionsCache =
+    std::string(CONFIG_CACHE_DIR) + "/buttons.bin";
+
+// the value of an optional key of a definition
+template <typename T>
+static std::optional<T> getOptional(const nlohmann::json& definition,
+                                    const char* key)
+{
+    if (!definition.contains(key))
+    {
+        return std::nullopt;
+    }
+    return definition[key].get<T>();
+}
+
+EventPriority getEventPriority(const std::string& formFactorName,
+                               std::string_view priority)
+{
+    if (priority == "high")
+    {
+        return EventPriority::high;
+    }
+    if (priority == "normal")
+    {
+        return EventPriority::normal;
+    }
+    if (priority == "low")
+    {
+        return EventPriority::low;
+    }
+    if (!priority.empty())
+    {
+        lg2::error("{NAME}: unknown priority {PRIORITY}", "NAME",
+                   formFactorName, "PRIORITY", priority);
+    }
+
+    if (formFactorName.starts_with("POWER_BUTTON") ||
+        formFactorName.starts_with("RESET_BUTTON"))
+    {
+        return EventPriority::high;
+    }
+    if (formFactorName == "SERIAL_UART_MUX")
+    {
+        return EventPriority::low;
+    }
+    return EventPriority::normal;
+}
+
+std::optional<uint16_t> getKeyCode(const std::string& formFactorName,
+                                   std::optional<uint16_t> keyCode)
+{
+    if (!keyCode && formFactorName.starts_with("POWER_BUTTON"))
+    {
+        keyCode = KEY_POWER;
+    }
+    if (!keyCode && formFactorName.starts_with("RESET_BUTTON"))
+    {
+        keyCode = KEY_RESTART;
+    }
+    if (!(formFactorName.starts_with("POWER_BUTTON") ||
+          formFactorName.starts_with("RESET_BUTTON") ||
+          (formFactorName == "ID_BTN")) ||
+        !keyCode)
+    {
+        lg2::error("{NAME}: not supported as an input button", "NAME",
+                   formFactorName);
+        return std::nullopt;
+    }
+    return keyCode;
+}
+
+/**
+ * @brief the gpios of a gpio definition, resolved to their gpiochip lines
+ * @return false when a gpio is not found
+ */
+static bool resolveGpios(ButtonConfig& buttonCfg,
+                         const nlohmann::json& definition)
+{
+    /* The following code checks if the gpio config read
+    from json file is single gpio config or group gpio config,
+    based on that further data is processed. */
+    lg2::debug("Found button config : {FORM_FACTOR_NAME}", "FORM_FACTOR_NAME",
+               buttonCfg.formFactorName);
+    bool resolved = true;
+    if (definition.contains("group_gpio_config"))
+    {
+        const auto& groupGpio = definition["group_gpio_config"];
+
+        for (const auto& config : groupGpio)
+        {
+            GpioInfo gpioCfg;
+            resolved = resolveGpio(gpioCfg, config) && resolved;
+            gpioCfg.direction = config["direction"];
+            gpioCfg.name = config["name"];
+            gpioCfg.polarity = (config.value("polarity", "") == "active_high")
+                                   ? GpioPolarity::activeHigh
+                                   : GpioPolarity::activeLow;
+            buttonCfg.gpios.push_back(gpioCfg);
+        }
+    }
+    else
+    {
+        GpioInfo gpioCfg;
+        resolved = resolveGpio(gpioCfg, definition);
+        gpioCfg.direction = definition["direction"];
+        gpioCfg.polarity = (definition.value("polarity", "") == "active_high")
+                               ? GpioPolarity::activeHigh
+                               : GpioPolarity::activeLow;
+        buttonCfg.gpios.push_back(gpioCfg);
+    }
+
+    if (!resolved)
+    {
+        lg2::error("{NAME}: gpio not found, skipping", "NAME",
+                   buttonCfg.formFactorName);
+    }
+    return resolved;
+}
+
+/**
+ * @brief the keys of a definition that only its form factor takes
+ */
+static void parseFormFactor(ButtonConfig& buttonCfg,
+                            const nlohmann::json& definition)
+{
+    if (buttonCfg.formFactorName == "HOST_SELECTOR")
+    {
+        // a cpld selector is decoded by the spec of its register instead
+        if (buttonCfg.type == ConfigType::gpio)
+        {
+            buttonCfg.hostSelector.positionMap =
+                definition.at("host_selector_map")
+                    .get<std::map<std::string, int>>();
+        }
+        buttonCfg.hostSelector.maxPosition =
+            definition.at("max_position").get<size_t>();
+    }
+    else if (buttonCfg.formFactorName == "SERIAL_UART_MUX")
+    {
+        for (const auto& [key, value] :
+             definition.at("serial_uart_mux_map").items())
+        {
+            buttonCfg.serialUartMux.muxMap[std::stoul(key)] =
+                value.get<size_t>();
+        }
+    }
+}
+
+/**
+ * @brief config of a button from its definition, with the gpios of a gpio
+ * definition resolved. Nothing of the definition is kept.
+ * @return std::nullopt for a definition the daemon doesn't serve
+ */
+static std::optional<ButtonConfig> makeButtonConfig(
+    ConfigType type, const nlohmann::json& definition)
+{
+    std::string formFactorName = definition.at("name");
+
+    /* There are additional gpio configs present in some platforms
+     that are not supported in phosphor-buttons.
+    But they may be used by other applications. so skipping such configs
+    if present in gpio_defs.json file, before resolving their pins */
+    if (!ButtonFactory::instance().isRegistered(formFactorName))
+    {
+        return std::nullopt;
+    }
+
+    ButtonConfig buttonCfg;
+    buttonCfg.type = type;
+    buttonCfg.formFactorName = formFactorName;
+    buttonCfg.debounce =
+        std::chrono::milliseconds(definition.value("debounce_ms", 0));
+    buttonCfg.priority =
+        getEventPriority(formFactorName, definition.value("priority", ""));
+    buttonCfg.gate = GateInfo(definition);
+    buttonCfg.polling.enabled = definition.value("polling_mode", false);
+    if (auto interval =
+            getOptional<uint32_t>(definition, "polling_interval_ms"))
+    {
+        buttonCfg.polling.interval = std::chrono::milliseconds(*interval);
+    }
+    if (auto interval =
+            getOptional<uint32_t>(definition, "polling_max_interval_ms"))
+    {
+        buttonCfg.polling.maxInterval = std::chrono::milliseconds(*interval);
+    }
+    parseFormFactor(buttonCfg, definition);
+    // a restarted daemon takes back the lines it had configured, and a
+    // reload keeps the buttons whose key didn't change
+    buttonCfg.fdStoreKey = FdStore::getKey(formFactorName, definition);
+
+    if (type == ConfigType::cpld)
+    {
+        CpldInfo cpldCfg;
+        // a register given by offset is read through i2c-dev, by name it is
+        // the attribute of the cpld driver
+        cpldCfg.registerOffset =
+            getOptional<uint8_t>(definition, "register_offset");
+        if (!cpldCfg.registerOffset)
+        {
+            cpldCfg.registerName = definition["register_name"];
+        }
+        // compiled once, the events are decoded with a table lookup
+        cpldCfg.decoder = CpldDecoder(definition);
+
+        cpldCfg.i2cAddress = definition["i2c_address"].get<int>();
+        cpldCfg.i2cBus = definition["i2c_bus"].get<int>();
+        buttonCfg.cpld = cpldCfg;
+    }
+    else if (type == ConfigType::input)
+    {
+        // buttons bound to an input driver such as gpio-keys, they only
+        // take a key
+        auto keyCode = getKeyCode(
+            formFactorName, getOptional<uint16_t>(definition, "key_code"));
+        if (!keyCode)
+        {
+            return std::nullopt;
+        }
+        buttonCfg.input.device = definition.value("device", "gpio-keys");
+        buttonCfg.input.keyCode = *keyCode;
+    }
+    else if (!resolveGpios(buttonCfg, definition))
+    {
+        return std::nullopt;
+    }
+    return buttonCfg;
+}
+
+/**
+ * @brief parses gpio_defs.json into the configs of the buttons it defines,
+ * in the order they are created: cpld, input then gpio definitions.
+ *
+ * The file is shared with other daemons, so it is parsed as a stream: the
+ * sections of other daemons are skipped without being built, and each
+ * definition is turned into its config and dropped as soon as it is parsed.
+ * At most one definition is held as json at any time.
+ */
+static std::vector<ButtonConfig> parseDefinitions(const std::string& content)
+{
+    using Event = nlohmann::json::parse_event_t;
+    constexpr std::array sections{
+        std::pair{"cpld_definitions", ConfigType::cpld},
+        std::pair{"input_definitions", ConfigType::input},
+        std::pair{"gpio_definitions", ConfigType::gpio}};
+
+    std::array<std::vector<ButtonConfig>, sections.size()> sectionConfigs;
+    std::optional<size_t> section; // being parsed
+
+    auto filter = [&](int depth, Event event, nlohmann::json& parsed) {
+        // the keys of the top level object are the sections
+        if ((depth == 1) && (event == Event::key))
+        {
+            section.reset();
+            for (size_t index = 0; index < sections.size(); index++)
+            {
+                if (parsed == sections[index].first)
+                {
+                    section = index;
+                }
+            }
+            return section.has_value();
+        }
+        if ((depth != 2) || (event != Event::object_end) || !section)
+        {
+            return true;
+        }
+
+        try
+        {
+            auto buttonCfg = makeButtonConfig(sections[*section].second,
+                                              parsed);
+            if (buttonCfg)
+            {
+                sectionConfigs[*section].emplace_back(std::move(*buttonCfg));
+            }
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Invalid {SECTION} entry {NAME}: {ERROR}", "SECTION",
+                       sections[*section].first, "NAME",
+                       parsed.value("name", ""), "ERROR", e);
+        }
+        return false;
+    };
+    // every entry is dropped once converted, nothing is left in the result
+    [[maybe_unused]] auto discarded =
+        nlohmann::json::parse(content, filter, true);
+
+    std::vector<ButtonConfig> buttonConfigs;
+    for (auto& configs : sectionConfigs)
+    {
+        std::ranges::move(configs, std::back_inserter(buttonConfigs));
+    }
+    return buttonConfigs;
+}
+
+template <typename T>
+static void writeOptional(ConfigCacheWriter& cache,
+                          const std::optional<T>& value)
+{
+    cache.write(value.has_value());
+    cache.write(value.value_or(T{}));
+}
+
+template <typename Key, typename Value>
+static void writeMap(ConfigCacheWriter& cache,
+                     const std::map<Key, Value>& values)
+{
+    cache.write(static_cast<uint32_t>(values.size()));
+    for (const auto& [key, value] : values)
+    {
+        cache.write(key);
+        cache.write(value);
+    }
+}
+
+/**
+ * @brief writes the button configs compiled from gpio_defs.json, every
+ * field that was parsed from the definition of a button in turn.
+ */
+static void saveDefinitions(const std::vector<ButtonConfig>& buttonConfigs,
+                            uint64_t key)
+{
+    ConfigCacheWriter cache;
+    cache.write(static_cast<uint32_t>(buttonConfigs.size()));
+    for (const auto& buttonCfg : buttonConfigs)
+    {
+        cache.write(buttonCfg.type);
+        cache.write(buttonCfg.formFactorName);
+        cache.write(buttonCfg.debounce);
+        cache.write(buttonCfg.priority);
+        cache.write(buttonCfg.polling.enabled);
+        writeOptional(cache, buttonCfg.polling.interval);
+        writeOptional(cache, buttonCfg.polling.maxInterval);
+        cache.write(buttonCfg.gate.presenceObject);
+        cache.write(buttonCfg.gate.presenceDefault);
+        cache.write(buttonCfg.gate.powerState);
+        cache.write(buttonCfg.gate.powerStateObject);
+        cache.write(buttonCfg.fdStoreKey);
+
+        cache.write(buttonCfg.cpld.registerName);
+        cache.write(buttonCfg.cpld.i2cAddress);
+        cache.write(buttonCfg.cpld.i2cBus);
+        writeOptional(cache, buttonCfg.cpld.registerOffset);
+        cache.write(buttonCfg.cpld.decoder);
+        cache.write(buttonCfg.input.device);
+        cache.write(buttonCfg.input.keyCode);
+
+        writeMap(cache, buttonCfg.hostSelector.positionMap);
+        cache.write(buttonCfg.hostSelector.maxPosition);
+        writeMap(cache, std::map<size_t, size_t>(
+                            buttonCfg.serialUartMux.muxMap.begin(),
+                            buttonCfg.serialUartMux.muxMap.end()));
+
+        cache.write(static_cast<uint32_t>(buttonCfg.gpios.size()));
+        for (const auto& gpio : buttonCfg.gpios)
+        {
+            cache.write(gpio.number);
+            cache.write(gpio.chipId);
+            cache.write(gpio.offset);
+            cache.write(gpio.polarity);
+            cache.write(gpio.name);
+            cache.write(gpio.direction);
+        }
+    }
+    cache.save(definitionsCache, key);
+}
+
+static bool readString(ConfigCacheReader& cache, std::string& text)
+{
+    std::string_view view;
+    if (!cache.read(view))
+    {
+        return false;
+    }
+    text = view;
+    return true;
+}
+
+template <typename T>
+static bool readOptional(ConfigCacheReader& cache, std::optional<T>& value)
+{
+    bool hasValue = false;
+    T read{};
+    if (!cache.read(hasValue) || !cache.read(read))
+    {
+        return false;
+    }
+    value = hasValue ? std::optional<T>(read) : std::nullopt;
+    return true;
+}
+
+template <typename Map>
+static bool readMap(ConfigCacheReader& cache, Map& values)
+{
+    uint32_t count = 0;
+    bool valid = cache.read(count);
+    for (uint32_t index = 0; valid && (index < count); index++)
+    {
+        typename Map::key_type key{};
+        typename Map::mapped_type value{};
+        if constexpr (std::is_same_v<typename Map::key_type, std::string>)
+        {
+            valid = readString(cache, key);
+        }
+        else
+        {
+            valid = cache.read(key);
+        }
+        valid = valid && cache.read(value);
+        values.emplace(std::move(key), value);
+    }
+    return valid;
+}
+
+/**
+ * @brief reads a button config written by saveDefinitions()
+ * @return false past the end of the cache, or on a value the config can't
+ * hold
+ */
+static bool readButtonConfig(ConfigCacheReader& cache, ButtonConfig& buttonCfg)
+{
+    uint32_t gpioCount = 0;
+    bool valid =
+        cache.read(buttonCfg.type,
+                   {ConfigType::gpio, ConfigType::cpld, ConfigType::input}) &&
+        readString(cache, buttonCfg.formFactorName) &&
+        cache.read(buttonCfg.debounce) &&
+        cache.read(buttonCfg.priority,
+                   {EventPriority::high, EventPriority::normal,
+                    EventPriority::low}) &&
+        cache.read(buttonCfg.polling.enabled) &&
+        readOptional(cache, buttonCfg.polling.interval) &&
+        readOptional(cache, buttonCfg.polling.maxInterval) &&
+        readString(cache, buttonCfg.gate.presenceObject) &&
+        readString(cache, buttonCfg.gate.presenceDefault) &&
+        readString(cache, buttonCfg.gate.powerState) &&
+        readString(cache, buttonCfg.gate.powerStateObject) &&
+        readString(cache, buttonCfg.fdStoreKey) &&
+        readString(cache, buttonCfg.cpld.registerName) &&
+        cache.read(buttonCfg.cpld.i2cAddress) &&
+        cache.read(buttonCfg.cpld.i2cBus) &&
+        readOptional(cache, buttonCfg.cpld.registerOffset) &&
+        cache.read(buttonCfg.cpld.decoder) &&
+        buttonCfg.cpld.decoder.isValid() &&
+        readString(cache, buttonCfg.input.device) &&
+        cache.read(buttonCfg.input.keyCode) &&
+        readMap(cache, buttonCfg.hostSelector.positionMap) &&
+        cache.read(buttonCfg.hostSelector.maxPosition) &&
+        readMap(cache, buttonCfg.serialUartMux.muxMap) &&
+        cache.read(gpioCount);
+
+    for (uint32_t index = 0; valid && (index < gpioCount); index++)
+    {
+        GpioInfo gpio;
+        valid = cache.read(gpio.number) && cache.read(gpio.chipId) &&
+                cache.read(gpio.offset) &&
+                cache.read(gpio.polarity, {GpioPolarity::activeLow,
+                                           GpioPolarity::activeHigh}) &&
+                readString(cache, gpio.name) &&
+                readString(cache, gpio.direction);
+        buttonCfg.gpios.push_back(std::move(gpio));
+    }
+    return valid;
+}
+
+/**
+ * @brief maps the button configs compiled by an earlier start from the same
+ * gpio_defs.json and gpiochips, see saveDefinitions()
+ * @return std::nullopt when there is no such cache
+ */
+static std::optional<std::vector<ButtonConfig>> loadDefinitions(uint64_t key)
+{
+    auto cache = ConfigCacheReader::open(definitionsCache, key);
+    if (!cache)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<ButtonConfig> buttonConfigs;
+    uint32_t count = 0;
+    bool valid = cache->read(count);
+    for (uint32_t index = 0; valid && (index < count); index++)
+    {
+        valid = readButtonConfig(*cache, buttonConfigs.emplace_back());
+    }
+
+    if (!valid || !cache->atEnd())
+    {
+        lg2::error("Invalid {PATH}, ignored", "PATH", definitionsCache);
+        return std::nullopt;
+    }
+    lg2::info("Loaded {COUNT} button definitions from {PATH}", "COUNT",
+              buttonConfigs.size(), "PATH", definitionsCache);
+    return buttonConfigs;
+}
+
+std::vector<ButtonConfig> loadButtonConfigs(const std::string& path)
+{
+    // gpio_defs.json is shared with other daemons and large, the buttons it
+    // defines are compiled once and mapped on the next starts, as long as
+    // neither the file nor the gpiochips changed
+    std::string content;
+    auto key = hashText(
+        std::to_string(hashConfigFile(path, content).value_or(0)) +
+        GpioChipIndex::instance().getChipsKey() +
+        ButtonFactory::instance().getRegisteredNames() +
+        (GPIO_CHARDEV ? "chardev" : "sysfs"));
+    if (auto buttonConfigs = loadDefinitions(key))
+    {
+        return std::move(*buttonConfigs);
+    }
+
+    auto buttonConfigs = parseDefinitions(content);
+    saveDefinitions(buttonConfigs, key);
+    return buttonConfigs;
+}
@@ -0,0 +1,364 @@
+#include "button_gate.hpp"
+
+#include "timer_wheel.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace sdbusRule = sdbusplus::bus::match::rules;
+
+constexpr auto itemIface = "xyz.openbmc_project.Inventory.Item";
+constexpr auto chassisIface = "xyz.openbmc_project.State.Chassis";
+constexpr auto propertyIface = "org.freedesktop.DBus.Properties";
+constexpr auto mapperIface = "xyz.openbmc_project.ObjectMapper";
+constexpr auto mapperObjPath = "/xyz/openbmc_project/object_mapper";
+constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
+constexpr auto defaultChassisObject = "/xyz/openbmc_project/state/chassis0";
+constexpr auto powerStatePrefix =
+    "xyz.openbmc_project.State.Chassis.PowerState.";
+
+// errors of a read that won't succeed until the object is added
+constexpr auto missingErrors = std::to_array<std::string_view>({
+    "xyz.openbmc_project.Common.Error.ResourceNotFound",
+    "org.freedesktop.DBus.Error.UnknownObject",
+    "org.freedesktop.DBus.Error.UnknownInterface",
+    "org.freedesktop.DBus.Error.UnknownProperty",
+    "org.freedesktop.DBus.Error.InvalidArgs",
+});
+
+// delays between the reads of a property whose owner or mapper isn't up
+constexpr auto readRetryDelay = std::chrono::seconds(1);
+constexpr auto readRetryMaxDelay = std::chrono::seconds(32);
+
+/**
+ * @brief a property followed by the gates, shared by the gates of every
+ * button naming its object. It is read through the mapper with asynchronous
+ * calls, retried while the mapper or the owner of the object don't answer,
+ * and followed through PropertiesChanged, InterfacesAdded and
+ * InterfacesRemoved.
+ */
+class ButtonGate::Property
+{
+  public:
+    // the property of path, created when no gate follows it yet
+    static std::shared_ptr<Property> get(sdbusplus::bus_t& bus,
+                                         const std::string& path,
+                                         const std::string& interface,
+                                         const std::string& name);
+
+    Property(sdbusplus::bus_t& bus, const std::string& path,
+             const std::string& interface, const std::string& name);
+    ~Property();
+
+    Property(const Property&) = delete;
+    Property& operator=(const Property&) = delete;
+
+    // std::nullopt until read, or while the object is missing
+    const std::optional<Value>& value() const
+    {
+        return current;
+    }
+
+    void subscribe(ButtonGate& gate)
+    {
+        gates.push_back(&gate);
+    }
+
+    void unsubscribe(ButtonGate& gate)
+    {
+        std::erase(gates, &gate);
+    }
+
+  private:
+    using Key = std::tuple<std::string, std::string, std::string>;
+    using Properties = std::map<std::string, Value>;
+
+    static std::map<Key, std::weak_ptr<Property>>& registry();
+
+    // asks the mapper for the owner of the object, then reads the value
+    void read();
+    void readValue(const std::string& service);
+    // handles an error reply, true when the read is over
+    bool failed(sdbusplus::message_t& reply);
+    void set(std::optional<Value> value);
+
+    sdbusplus::bus_t& bus;
+    Key key;
+    std::optional<Value> current;
+    std::vector<ButtonGate*> gates;
+    std::vector<std::unique_ptr<sdbusplus::bus::match_t>> matches;
+    std::optional<sdbusplus::slot_t> pending; // call of the running read
+    TimerWheel::Timer retryTimer;
+    std::chrono::milliseconds retryDelay = readRetryDelay;
+};
+
+std::map<ButtonGate::Property::Key, std::weak_ptr<ButtonGate::Property>>&
+    ButtonGate::Property::registry()
+{
+    static std::map<Key, std::weak_ptr<Property>> properties;
+    return properties;
+}
+
+std::shared_ptr<ButtonGate::Property> ButtonGate::Property::get(
+    sdbusplus::bus_t& bus, const std::string& path,
+    const std::string& interface, const std::string& name)
+{
+    auto& property = registry()[Key(path, interface, name)];
+    auto shared = property.lock();
+    if (!shared)
+    {
+        shared = std::make_shared<Property>(bus, path, interface, name);
+        property = shared;
+    }
+    return shared;
+}
+
+ButtonGate::Property::Property(sdbusplus::bus_t& bus, const std::string& path,
+                               const std::string& interface,
+                               const std::string& name) :
+    bus(bus), key(path, interface, name), retryTimer([this]() { read(); })
+{
+    // watched before the first read, so no change is missed in between
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus, sdbusRule::propertiesChanged(path, interface),
+        [this](sdbusplus::message_t& msg) {
+            std::string changedInterface;
+            Properties properties;
+            msg.read(changedInterface, properties);
+            auto value = properties.find(std::get<2>(key));
+            if (value != properties.end())
+            {
+                set(value->second);
+            }
+        }));
+
+    // the owner of the object may start after the buttons
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus, sdbusRule::interfacesAdded() + sdbusRule::argNpath(0, path),
+        [this](sdbusplus::message_t& msg) {
+            sdbusplus::message::object_path objectPath;
+            std::map<std::string, Properties> interfaces;
+            msg.read(objectPath, interfaces);
+            auto properties = interfaces.find(std::get<1>(key));
+            if (properties == interfaces.end())
+            {
+                return;
+            }
+            auto value = properties->second.find(std::get<2>(key));
+            if (value != properties->second.end())
+            {
+                set(value->second);
+            }
+        }));
+
+    // a pulled sled takes its inventory item with it
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus, sdbusRule::interfacesRemoved() + sdbusRule::argNpath(0, path),
+        [this](sdbusplus::message_t& msg) {
+            sdbusplus::message::object_path objectPath;
+            std::vector<std::string> interfaces;
+            msg.read(objectPath, interfaces);
+            if (std::ranges::find(interfaces, std::get<1>(key)) !=
+                interfaces.end())
+            {
+                set(std::nullopt);
+            }
+        }));
+
+    read();
+}
+
+ButtonGate::Property::~Property()
+{
+    registry().erase(key);
+}
+
+void ButtonGate::Property::read()
+{
+    const auto& [path, interface, name] = key;
+    try
+    {
+        auto method = bus.new_method_call(mapperService, mapperObjPath,
+                                          mapperIface, "GetObject");
+        method.append(path, std::vector{interface});
+        pending = bus.call_async(method, [this](sdbusplus::message_t& reply) {
+            if (failed(reply))
+            {
+                return;
+            }
+            std::map<std::string, std::vector<std::string>> objectData;
+            reply.read(objectData);
+            if (!objectData.empty())
+            {
+                readValue(objectData.begin()->first);
+            }
+        });
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed reading {PATH} {PROPERTY}: {ERROR}", "PATH", path,
+                   "PROPERTY", name, "ERROR", e);
+    }
+}
+
+void ButtonGate::Property::readValue(const std::string& service)
+{
+    const auto& [path, interface, name] = key;
+    try
+    {
+        auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                          propertyIface, "Get");
+        method.append(interface, name);
+        pending = bus.call_async(method, [this](sdbusplus::message_t& reply) {
+            if (failed(reply))
+            {
+                return;
+            }
+            Value value;
+            reply.read(value);
+            set(value);
+        });
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed reading {PATH} {PROPERTY}: {ERROR}", "PATH", path,
+                   "PROPERTY", name, "ERROR", e);
+    }
+}
+
+bool ButtonGate::Property::failed(sdbusplus::message_t& reply)
+{
+    if (!reply.is_method_error())
+    {
+        return false;
+    }
+
+    const auto& [path, interface, name] = key;
+    const auto* error = reply.get_error();
+    std::string_view errorName = (error && error->name) ? error->name : "";
+    if (std::ranges::find(missingErrors, errorName) != missingErrors.end())
+    {
+        // InterfacesAdded tells when the object shows up
+        lg2::info("{PATH} {PROPERTY} not found", "PATH", path, "PROPERTY",
+                  name);
+        return true;
+    }
+
+    // the mapper or the owner of the object isn't up yet
+    lg2::info("Failed reading {PATH} {PROPERTY}, retrying: {ERROR}", "PATH",
+              path, "PROPERTY", name, "ERROR", errorName);
+    retryTimer.restartOnce(retryDelay);
+    retryDelay = std::min<std::chrono::milliseconds>(retryDelay * 2,
+                                                     readRetryMaxDelay);
+    return true;
+}
+
+void ButtonGate::Property::set(std::optional<Value> value)
+{
+    current = std::move(value);
+    // a gate may be destroyed by the callback of another
+    auto followers = gates;
+    for (auto* gate : followers)
+    {
+        if (std::ranges::find(gates, gate) != gates.end())
+        {
+            gate->update();
+        }
+    }
+}
+
+GateInfo::GateInfo(const nlohmann::json& config) :
+    presenceObject(config.value("presence_object", "")),
+    presenceDefault(config.value("presence_default", "")),
+    powerState(config.value("power_state", "")),
+    powerStateObject(config.value("power_state_object", ""))
+{}
+
+std::unique_ptr<ButtonGate> ButtonGate::create(
+    sdbusplus::bus_t& bus, const GateInfo& info, Changed changed)
+{
+    if (info.empty())
+    {
+        return nullptr;
+    }
+    return std::make_unique<ButtonGate>(bus, info, std::move(changed));
+}
+
+ButtonGate::ButtonGate(sdbusplus::bus_t& bus, const GateInfo& info,
+                       Changed changed) : changed(std::move(changed))
+{
+    if (!info.presenceObject.empty())
+    {
+        presentByDefault = (info.presenceDefault == "present");
+        presence =
+            Property::get(bus, info.presenceObject, itemIface, "Present");
+        presence->subscribe(*this);
+    }
+
+    if (!info.powerState.empty())
+    {
+        powerState = std::string(powerStatePrefix) +
+                     ((info.powerState == "off") ? "Off" : "On");
+        std::string path = info.powerStateObject.empty()
+                               ? defaultChassisObject
+                               : info.powerStateObject;
+        power = Property::get(bus, path, chassisIface, "CurrentPowerState");
+        power->subscribe(*this);
+    }
+
+    // an object already followed for another button is known right away
+    open = evaluate();
+}
+
+ButtonGate::~ButtonGate()
+{
+    if (presence)
+    {
+        presence->unsubscribe(*this);
+    }
+    if (power)
+    {
+        power->unsubscribe(*this);
+    }
+}
+
+bool ButtonGate::evaluate() const
+{
+    if (presence)
+    {
+        const auto& value = presence->value();
+        const auto* isPresent = value ? std::get_if<bool>(&*value) : nullptr;
+        if (!(isPresent ? *isPresent : presentByDefault))
+        {
+            return false;
+        }
+    }
+    if (power && power->value())
+    {
+        const auto* state = std::get_if<std::string>(&*power->value());
+        if (state && (*state != powerState))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ButtonGate::update()
+{
+    auto isOpen = evaluate();
+    if (isOpen != open)
+    {
+        open = isOpen;
+        changed(open);
+    }
+}
@@ -1,8 +1,14 @@
 #include "button_handler.hpp"
 
+#include "common.hpp"
 #include "config.hpp"
+#include "config_cache.hpp"
 #include "gpio.hpp"
 #include "power_button_profile_factory.hpp"
+#include "startup_timing.hpp"
+#if PLATFORM_TABLES
+#include "platform_multi_actions.hpp"
+#endif
 
 #include <phosphor-logging/lg2.hpp>
 #include <xyz/openbmc_project/Chassis/Buttons/Power/server.hpp>
@@ -46,8 +52,70 @@ constexpr auto mapperObjPath = "/xyz/openbmc_project/object_mapper";
 constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
 constexpr auto BMC_POSITION = 0;
 
+// form factor of the power buttons, POWER_BUTTON<n> for the slot n
+constexpr std::string_view powerButtonName = "POWER_BUTTON";
+
 std::vector<std::map<uint16_t, Chassis::Transition>> multiPwrBtnActConf;
 
+#if !PLATFORM_TABLES
+// the multi-action tables compiled by an earlier start
+const std::string multiActionCache =
+    std::string(CONFIG_CACHE_DIR) + "/button-handler.bin";
+
+/**
+ * @brief reads the multi-action tables written by Handler::loadMultiActions
+ * @return false when the cache is not complete
+ */
+static bool readMultiActions(ConfigCacheReader& cache, bool& supported,
+                             std::vector<size_t>& indexes)
+{
+    uint32_t count = 0;
+    if (!cache.read(supported) || !cache.read(count))
+    {
+        return false;
+    }
+
+    for (uint32_t index = 0; index < count; index++)
+    {
+        uint32_t actionCount = 0;
+        if (!cache.read(actionCount))
+        {
+            return false;
+        }
+
+        auto& actions = multiPwrBtnActConf.emplace_back();
+        for (uint32_t action = 0; action < actionCount; action++)
+        {
+            uint16_t duration = 0;
+            Chassis::Transition transition{};
+            if (!cache.read(duration) ||
+                !cache.read(transition, {Chassis::Transition::On,
+                                         Chassis::Transition::Off,
+                                         Chassis::Transition::PowerCycle}))
+            {
+                return false;
+            }
+            actions[duration] = transition;
+        }
+    }
+
+    if (!cache.read(count))
+    {
+        return false;
+    }
+    for (uint32_t index = 0; index < count; index++)
+    {
+        uint32_t slot = 0;
+        if (!cache.read(slot))
+        {
+            return false;
+        }
+        indexes.push_back(slot);
+    }
+    return cache.atEnd();
+}
+#endif
+
 Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
 {
     /* So far, there are two modes for multi-host power control
@@ -58,45 +126,22 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
     - multi power button mode, e.g.: Greatlakes
     each slot/sled has its own power button,
     in the case, hostSelectButtonMode = false */
+    // the mapper calls below are timed one by one, they make most of the
+    // start
+    auto& timing = StartupTiming::instance();
     hostSelectButtonMode =
         !getService(HS_DBUS_OBJECT_NAME, hostSelectorIface).empty();
-    size_t powerButtonCount = 1;
+    timing.phase("host selector probe");
+
+    // each slot has its own power button, as many as the platform defines,
+    // known from the definitions rather than from the mapper, which may
+    // not have seen the buttons yet
+    loadMultiActions();
     if (!hostSelectButtonMode)
     {
-        powerButtonCount = phosphor::button::numberOfChassis();
-    }
-
-    std::ifstream gpios{gpioDefFile};
-    auto configDefJson = nlohmann::json::parse(gpios, nullptr, true);
-    nlohmann::json gpioDefs = configDefJson["gpio_definitions"];
-
-    for (const auto& gpioConfig : gpioDefs)
-    {
-        if (gpioConfig.contains("multi-action"))
-        {
-            std::map<uint16_t, Chassis::Transition> mapEntry;
-            const auto& multiActCfg = gpioConfig["multi-action"];
-            for (const auto& ActCfg : multiActCfg)
-            {
-                auto chassisPwrCtl = chassisPwrCtls.find(ActCfg["action"]);
-                if (chassisPwrCtl != chassisPwrCtls.end())
-                {
-                    auto duration = ActCfg["duration"].get<uint16_t>();
-                    mapEntry[duration] = chassisPwrCtl->second;
-                }
-                else
-                {
-                    lg2::error("unknown power button action");
-                }
-            }
-            multiPwrBtnActConf.emplace_back(mapEntry);
-        }
-        else
-        {
-            isButtonMultiActionSupport = false;
-            break;
-        }
+        chassisCount = std::max<size_t>(powerButtonIndexes.size(), 1);
     }
+    timing.phase("multi-action tables");
 
     try
     {
@@ -122,11 +167,10 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
 
         if (!hostSelectButtonMode && isButtonMultiActionSupport)
         {
-            lg2::info("Starting multi power button handler");
-            // The index, 'countIter', starts at 1 and increments,
-            // representing slot_1 through slot_N.
-            for (size_t countIter = 1; countIter <= powerButtonCount;
-                 countIter++)
+            lg2::info("Starting multi power button handler for {COUNT} slots",
+                      "COUNT", powerButtonIndexes.size());
+            // The index, 'countIter', starts at 1, representing slot_1.
+            for (auto countIter : powerButtonIndexes)
             {
                 std::unique_ptr<sdbusplus::bus::match_t>
                     multiPowerReleaseMatch =
@@ -148,6 +192,7 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
     {
         lg2::error("Error creating power button handler: {ERROR}", "ERROR", e);
     }
+    timing.phase("power button probe");
 
     try
     {
@@ -167,6 +212,7 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
     {
         // The button wasn't implemented
     }
+    timing.phase("ID button probe");
 
     try
     {
@@ -186,6 +232,7 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
     {
         // The button wasn't implemented
     }
+    timing.phase("reset button probe");
     try
     {
         if (!getService(DBG_HS_DBUS_OBJECT_NAME, debugHostSelectorIface)
@@ -205,10 +252,11 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
     {
         // The button wasn't implemented
     }
+    timing.phase("debug host selector probe");
 }
 bool Handler::isMultiHost()
 {
-    if (numberOfChassis() != 1)
+    if (chassisCount != 1)
     {
         return true;
     }
@@ -264,6 +312,140 @@ size_t Handler::getHostSelectorValue()
         throw;
     }
 }
+void Handler::loadMultiActions()
+{
+#if PLATFORM_TABLES
+    // compiled in from the gpio_defs.json of the platform
+    isButtonMultiActionSupport = platform::multiActionSupported;
+    for (const auto& actions : platform::multiActions)
+    {
+        multiPwrBtnActConf.emplace_back(actions.begin(), actions.end());
+    }
+    powerButtonIndexes.assign(platform::powerButtonIndexes.begin(),
+                              platform::powerButtonIndexes.end());
+#else
+    // only the multi-action tables are needed from the shared, large
+    // gpio_defs.json, they are mapped from the cache while it is unchanged
+    std::string content;
+    auto key = hashConfigFile(gpioDefFile, content).value_or(0);
+    if (auto cache = ConfigCacheReader::open(multiActionCache, key))
+    {
+        if (readMultiActions(*cache, isButtonMultiActionSupport,
+                             powerButtonIndexes))
+        {
+            return;
+        }
+        multiPwrBtnActConf.clear();
+        powerButtonIndexes.clear();
+        isButtonMultiActionSupport = true;
+    }
+
+    auto configDefJson = nlohmann::json::parse(content, nullptr, true);
+
+    // the power buttons the buttons daemon serves from the same file
+    for (const auto* section :
+         {"cpld_definitions", "input_definitions", "gpio_definitions"})
+    {
+        for (const auto& definition :
+             configDefJson.value(section, nlohmann::json::array()))
+        {
+            std::string name = definition.value("name", "");
+            auto indexed = splitIndexedName(name);
+            if (indexed && (indexed->first == powerButtonName))
+            {
+                powerButtonIndexes.push_back(indexed->second);
+            }
+        }
+    }
+    std::ranges::sort(powerButtonIndexes);
+    auto duplicates = std::ranges::unique(powerButtonIndexes);
+    powerButtonIndexes.erase(duplicates.begin(), duplicates.end());
+
+    nlohmann::json gpioDefs = configDefJson["gpio_definitions"];
+
+    for (const auto& gpioConfig : gpioDefs)
+    {
+        if (gpioConfig.contains("multi-action"))
+        {
+            std::map<uint16_t, Chassis::Transition> mapEntry;
+            const auto& multiActCfg = gpioConfig["multi-action"];
+            for (const auto& ActCfg : multiActCfg)
+            {
+                auto chassisPwrCtl = chassisPwrCtls.find(ActCfg["action"]);
+                if (chassisPwrCtl != chassisPwrCtls.end())
+                {
+                    auto duration = ActCfg["duration"].get<uint16_t>();
+                    mapEntry[duration] = chassisPwrCtl->second;
+                }
+                else
+                {
+                    lg2::error("unknown power button action");
+                }
+            }
+            multiPwrBtnActConf.emplace_back(mapEntry);
+        }
+        else
+        {
+            isButtonMultiActionSupport = false;
+            break;
+        }
+    }
+
+    ConfigCacheWriter cache;
+    cache.write(isButtonMultiActionSupport);
+    cache.write(static_cast<uint32_t>(multiPwrBtnActConf.size()));
+    for (const auto& actions : multiPwrBtnActConf)
+    {
+        cache.write(static_cast<uint32_t>(actions.size()));
+        for (const auto& [duration, transition] : actions)
+        {
+            cache.write(duration);
+            cache.write(transition);
+        }
+    }
+    cache.write(static_cast<uint32_t>(powerButtonIndexes.size()));
+    for (auto index : powerButtonIndexes)
+    {
+        cache.write(static_cast<uint32_t>(index));
+    }
+    cache.save(multiActionCache, key);
+#endif
+}
+
+void Handler::reloadMultiActions()
+{
+    auto actions = std::move(multiPwrBtnActConf);
+    auto supported = isButtonMultiActionSupport;
+    auto indexes = std::move(powerButtonIndexes);
+    multiPwrBtnActConf.clear();
+    powerButtonIndexes.clear();
+    isButtonMultiActionSupport = true;
+
+    try
+    {
+        loadMultiActions();
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Keeping the multi-action tables, reload failed: {ERROR}",
+                   "ERROR", e);
+        multiPwrBtnActConf = std::move(actions);
+        isButtonMultiActionSupport = supported;
+        powerButtonIndexes = std::move(indexes);
+        return;
+    }
+
+    // the matches of the multi power buttons are only set up at start
+    if ((isButtonMultiActionSupport != supported) ||
+        (powerButtonIndexes != indexes))
+    {
+        lg2::info("Multi-action support or slots changed, applied on restart");
+    }
+    powerButtonIndexes = std::move(indexes);
+    lg2::info("Reloaded {COUNT} multi-action tables", "COUNT",
+              multiPwrBtnActConf.size());
+}
+
 bool Handler::poweredOn(size_t hostNumber) const
 {
     auto hostObjectName = HOST_STATE_OBJECT_NAME + std::to_string(hostNumber);
@@ -317,7 +499,15 @@ void Handler::handlePowerEvent(PowerEvent powerEventType,
     {
         case PowerEvent::powerReleased:
         {
-            for (const auto& iter : multiPwrBtnActConf[stoi(hostNumStr) - 1])
+            // a reload may have dropped the table of the host
+            size_t tableIndex = stoi(hostNumStr) - 1;
+            if (tableIndex >= multiPwrBtnActConf.size())
+            {
+                lg2::error("No multi-action table for host {HOST}", "HOST",
+                           hostNumStr);
+                return;
+            }
+            for (const auto& iter : multiPwrBtnActConf[tableIndex])
             {
                 if (duration > std::chrono::milliseconds(iter.first))
                 {
@@ -1,15 +1,28 @@
 #include "button_handler.hpp"
+#include "config_watcher.hpp"
+#include "startup_timing.hpp"
 
 #include <sdeventplus/event.hpp>
 
 int main(void)
 {
+    auto& timing = StartupTiming::instance();
     auto bus = sdbusplus::bus::new_default();
     auto event = sdeventplus::Event::get_default();
 
     bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    timing.phase("event loop and bus");
 
     phosphor::button::Handler handler{bus};
 
+#if !PLATFORM_TABLES
+    // only the multi-action tables are taken from gpio_defs.json
+    ConfigWatcher configWatcher(event.get(), gpioDefFile,
+                                [&handler]() { handler.reloadMultiActions(); });
+#endif
+
+    // the matches of every button are in place
+    timing.ready("button-handler");
+
     return event.loop();
 }
@@ -0,0 +1,200 @@
+#include "config_cache.hpp"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+// written first, a cache of another format is never read
+constexpr std::string_view cacheMagic = "PBCFG006";
+
+struct CacheHeader
+{
+    std::array<char, cacheMagic.size()> magic;
+    uint64_t build; // hash of the build id of the daemon that wrote it
+    uint64_t key;
+    uint64_t size; // of the values that follow
+};
+
+/**
+ * @brief hash of the GNU build id of the daemon. The values are mapped as
+ * the daemon lays them out, so a cache is only read by the build that wrote
+ * it, whether or not the magic was bumped with a format change. Without a
+ * build id, only the magic tells the formats apart.
+ */
+static uint64_t getBuildHash()
+{
+    static const uint64_t hash = []() {
+        std::string_view buildId;
+        // the first object is the daemon itself
+        dl_iterate_phdr(
+            [](dl_phdr_info* info, size_t, void* data) {
+                for (ElfW(Half) index = 0; index < info->dlpi_phnum; index++)
+                {
+                    const auto& segment = info->dlpi_phdr[index];
+                    if (segment.p_type != PT_NOTE)
+                    {
+                        continue;
+                    }
+                    size_t align = (segment.p_align == 8) ? 8 : 4;
+                    auto padded = [align](size_t size) {
+                        return (size + align - 1) & ~(align - 1);
+                    };
+                    const auto* note = reinterpret_cast<const char*>(
+                        info->dlpi_addr + segment.p_vaddr);
+                    const auto* end = note + segment.p_memsz;
+                    while (note + sizeof(ElfW(Nhdr)) <= end)
+                    {
+                        ElfW(Nhdr) header;
+                        std::memcpy(&header, note, sizeof(header));
+                        const auto* name = note + sizeof(header);
+                        const auto* desc = name + padded(header.n_namesz);
+                        if ((header.n_type == NT_GNU_BUILD_ID) &&
+                            (std::string_view(name, header.n_namesz) ==
+                             std::string_view("GNU", 4)))
+                        {
+                            *static_cast<std::string_view*>(data) =
+                                std::string_view(desc, header.n_descsz);
+                            return 1;
+                        }
+                        note = desc + padded(header.n_descsz);
+                    }
+                }
+                return 1;
+            },
+            &buildId);
+        return hashText(buildId);
+    }();
+    return hash;
+}
+
+std::optional<uint64_t> hashConfigFile(const std::string& path,
+                                       std::string& content)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    content.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+    return hashText(content);
+}
+
+bool ConfigCacheWriter::save(const std::string& path, uint64_t key) const
+{
+    CacheHeader header{};
+    std::ranges::copy(cacheMagic, header.magic.begin());
+    header.build = getBuildHash();
+    header.key = key;
+    header.size = bytes.size();
+
+    try
+    {
+        fs::path cachePath{path};
+        fs::create_directories(cachePath.parent_path());
+
+        auto tmpPath = cachePath;
+        tmpPath += ".tmp";
+        {
+            std::ofstream file{tmpPath, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(bytes.data(), bytes.size());
+            if (!file)
+            {
+                throw std::runtime_error("short write");
+            }
+        }
+        fs::rename(tmpPath, cachePath);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Error writing {PATH}: {ERROR}", "PATH", path, "ERROR", e);
+        return false;
+    }
+    return true;
+}
+
+std::optional<ConfigCacheReader> ConfigCacheReader::open(
+    const std::string& path, uint64_t key)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    struct stat status{};
+    void* mapping = MAP_FAILED;
+    if ((::fstat(fd, &status) == 0) &&
+        (static_cast<size_t>(status.st_size) >= sizeof(CacheHeader)))
+    {
+        mapping = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd,
+                         0);
+    }
+    // the mapping keeps the file
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return std::nullopt;
+    }
+
+    size_t size = status.st_size;
+    CacheHeader header{};
+    std::memcpy(&header, mapping, sizeof(header));
+    if (!std::ranges::equal(header.magic, cacheMagic) ||
+        (header.build != getBuildHash()) || (header.key != key) ||
+        (header.size != size - sizeof(header)))
+    {
+        ::munmap(mapping, size);
+        return std::nullopt;
+    }
+
+    return ConfigCacheReader(
+        mapping, size,
+        std::span(static_cast<const char*>(mapping) + sizeof(header),
+                  header.size));
+}
+
+ConfigCacheReader::ConfigCacheReader(void* mapping, size_t size,
+                                     std::span<const char> data) :
+    mapping(mapping), size(size), data(data)
+{}
+
+ConfigCacheReader::ConfigCacheReader(ConfigCacheReader&& other) noexcept :
+    mapping(std::exchange(other.mapping, nullptr)), size(other.size),
+    data(other.data)
+{}
+
+ConfigCacheReader::~ConfigCacheReader()
+{
+    if (mapping != nullptr)
+    {
+        ::munmap(mapping, size);
+    }
+}
+
+bool ConfigCacheReader::read(std::string_view& text)
+{
+    uint32_t length = 0;
+    if (!read(length) || (data.size() < length))
+    {
+        return false;
+    }
+    text = std::string_view(data.data(), length);
+    data = data.subspan(length);
+    return true;
+}
@@ -0,0 +1,99 @@
+#include "config_watcher.hpp"
+
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <array>
+#include <cerrno>
+#include <filesystem>
+
+// quiet time after the last event before the file is read again
+constexpr auto configSettleDelay = std::chrono::milliseconds(200);
+
+ConfigWatcher::ConfigWatcher(sd_event* event, const std::string& path,
+                             Changed changed) :
+    settleTimer([this]() { this->changed(); }), changed(std::move(changed))
+{
+    std::filesystem::path file(path);
+    name = file.filename();
+    auto directory = file.has_parent_path() ? file.parent_path()
+                                            : std::filesystem::path(".");
+
+    fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        lg2::error("{PATH}: inotify error: {ERROR}", "PATH", path, "ERROR",
+                   errno);
+        return;
+    }
+    if (::inotify_add_watch(fd, directory.c_str(),
+                            IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        lg2::error("{PATH}: failed to watch {DIR}: {ERROR}", "PATH", path,
+                   "DIR", directory.string(), "ERROR", errno);
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    try
+    {
+        source.emplace(sdeventplus::Event(event), fd, EPOLLIN,
+                       [this](sdeventplus::source::IO&, int, uint32_t) {
+                           dispatch();
+                       });
+    }
+    catch (const std::system_error& e)
+    {
+        lg2::error("{PATH}: failed to add the watch to event loop: {ERROR}",
+                   "PATH", path, "ERROR", e);
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    lg2::info("Watching {PATH} for changes", "PATH", path);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    source.reset();
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+void ConfigWatcher::dispatch()
+{
+    alignas(inotify_event) std::array<char, 4096> buffer;
+    bool matched = false;
+
+    while (true)
+    {
+        auto size = ::read(fd, buffer.data(), buffer.size());
+        if (size <= 0)
+        {
+            break;
+        }
+        for (ssize_t offset = 0; offset < size;)
+        {
+            const auto* event =
+                reinterpret_cast<const inotify_event*>(&buffer[offset]);
+            if ((event->len > 0) && (name == event->name))
+            {
+                matched = true;
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    // an update may close or rename the file more than once, it is read
+    // once they are done
+    if (matched)
+    {
+        settleTimer.restartOnce(configSettleDelay);
+    }
+}
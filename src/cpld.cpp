@@ -1,15 +1,121 @@
+#include "cpld.hpp"
 
 #include "button_config.hpp"
+#include "button_interface.hpp"
 #include "config.hpp"
+#include "poll_scheduler.hpp"
 
 #include <error.h>
 #include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <phosphor-logging/lg2.hpp>
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+
 const std::string cpldDev = "/sys/bus/i2c/devices/";
 
+// registers this close to a run are read with it rather than by a run of
+// their own, a few bytes cost less than another start and address
+constexpr int maxRunGap = 4;
+
+CpldDecoder::CpldDecoder(const nlohmann::json& config)
+{
+    std::string formatName = config.value("format", "decimal");
+    Format format = Format::decimal;
+    if (config.contains("register_offset") || (formatName == "raw"))
+    {
+        format = Format::raw;
+    }
+    else if (formatName == "hex")
+    {
+        format = Format::hex;
+    }
+    else if (formatName != "decimal")
+    {
+        lg2::error("Unknown cpld value format {FORMAT}, reading decimal",
+                   "FORMAT", formatName);
+    }
+
+    uint8_t mask = config.value("mask", 0xff);
+    if (mask == 0)
+    {
+        lg2::error("Empty cpld value mask, reading the whole register");
+        mask = 0xff;
+    }
+    int shift = std::clamp(config.value("shift", std::countr_zero(mask)), 0,
+                           7);
+
+    // the values of the button by shifted value, the identity without a map
+    std::vector<ValueMapping> valueMap;
+    std::optional<std::span<const ValueMapping>> mappings;
+    if (config.contains("value_map"))
+    {
+        for (const auto& [key, position] : config["value_map"].items())
+        {
+            try
+            {
+                valueMap.emplace_back(std::stoul(key, nullptr, 0),
+                                      position.get<uint16_t>());
+            }
+            catch (const std::exception& e)
+            {
+                lg2::error("Invalid cpld value_map entry {KEY}: {ERROR}",
+                           "KEY", key, "ERROR", e);
+            }
+        }
+        mappings = valueMap;
+    }
+
+    *this = CpldDecoder(format, mask, shift, mappings);
+}
+
+std::optional<uint16_t> CpldDecoder::read(int fd) const
+{
+    std::array<char, 16> text;
+
+    // pread() rewinds and reads in one call, which also rearms POLLPRI
+    auto size = ::pread(fd, text.data(), text.size(), 0);
+    if (size < 0)
+    {
+        lg2::error("CPLD read error {FD}: {ERROR}", "FD", fd, "ERROR", errno);
+        return std::nullopt;
+    }
+    if (size == 0)
+    {
+        return invalidValue;
+    }
+    if (format == Format::raw)
+    {
+        return table[static_cast<uint8_t>(text[0])];
+    }
+
+    const char* begin = text.data();
+    const char* end = begin + size;
+    int base = 10;
+    if (format == Format::hex)
+    {
+        base = 16;
+        if ((size > 2) && (begin[0] == '0') && ((begin[1] | 0x20) == 'x'))
+        {
+            begin += 2;
+        }
+    }
+
+    unsigned value = 0;
+    auto [next, error] = std::from_chars(begin, end, value, base);
+    if ((error != std::errc()) || (value >= table.size()))
+    {
+        return invalidValue;
+    }
+    return table[value];
+}
+
 std::string getCpldDevPath(const CpldInfo& info)
 {
     std::stringstream devPath;
@@ -20,6 +126,11 @@ std::string getCpldDevPath(const CpldInfo& info)
 
 int configCpld(ButtonConfig& buttonIFConfig)
 {
+    if (buttonIFConfig.cpld.registerOffset)
+    {
+        return 0;
+    }
+
     std::string devPath = getCpldDevPath(buttonIFConfig.cpld);
 
     auto fd = ::open(devPath.c_str(), O_RDONLY | O_NONBLOCK);
@@ -35,3 +146,283 @@ int configCpld(ButtonConfig& buttonIFConfig)
     buttonIFConfig.fds.push_back(fd);
     return 0;
 }
+
+int CpldDevices::add(const CpldInfo& cpld, std::chrono::milliseconds interval,
+                     std::chrono::milliseconds maxInterval, ButtonIface& owner)
+{
+    auto key = std::make_pair(cpld.i2cBus, cpld.i2cAddress);
+    auto [entry, added] = devices.try_emplace(key);
+    auto& device = entry->second;
+
+    if (added)
+    {
+        device.key = key;
+        device.path = std::string(I2C_DEV_DIR) + "/i2c-" +
+                      std::to_string(cpld.i2cBus);
+        device.interval = interval;
+        device.maxInterval = maxInterval;
+        int ret = device.registers.open(
+            device.path, static_cast<uint16_t>(cpld.i2cAddress));
+        if (ret < 0)
+        {
+            lg2::error("Open {PATH} error: {ERROR}", "PATH", device.path,
+                       "ERROR", -ret);
+            devices.erase(entry);
+            return ret;
+        }
+    }
+
+    device.subscribers.push_back(
+        {*cpld.registerOffset, &cpld.decoder, &owner});
+    plan(device);
+
+    if (!device.registers.read())
+    {
+        remove(owner);
+        return -EIO;
+    }
+    auto& subscriber = device.subscribers.back();
+    subscriber.value = decode(device, subscriber);
+
+    // the device is sampled at the fastest rate of its buttons
+    if (!device.pollId || (interval < device.interval) ||
+        (maxInterval < device.maxInterval))
+    {
+        device.interval = std::min(device.interval, interval);
+        device.maxInterval = std::min(device.maxInterval, maxInterval);
+        if (device.pollId)
+        {
+            PollScheduler::instance().remove(*device.pollId);
+        }
+        device.pollId = PollScheduler::instance().add(
+            device.interval, device.maxInterval,
+            [this, key]() { return poll(devices.at(key)); });
+    }
+    return 0;
+}
+
+void CpldDevices::remove(ButtonIface& owner)
+{
+    for (auto entry = devices.begin(); entry != devices.end();)
+    {
+        auto& device = (entry++)->second;
+        auto removed =
+            std::erase_if(device.subscribers, [&owner](const auto& subscriber) {
+                return subscriber.owner == &owner;
+            });
+        // a device being polled is closed once its poll is done
+        if (device.subscribers.empty() && (&device != polling))
+        {
+            close(device);
+        }
+        else if (removed > 0)
+        {
+            plan(device);
+        }
+    }
+}
+
+void CpldDevices::setEnabled(ButtonIface& owner, bool enabled)
+{
+    for (auto& [key, device] : devices)
+    {
+        bool wasEnabled = std::ranges::any_of(device.subscribers,
+                                              &Subscriber::enabled);
+        bool resample = false;
+        for (auto& subscriber : device.subscribers)
+        {
+            if (subscriber.owner == &owner)
+            {
+                subscriber.enabled = enabled;
+                resample = enabled;
+            }
+        }
+
+        // the bits of owner may have changed while it was paused
+        if (resample && device.registers.read())
+        {
+            for (auto& subscriber : device.subscribers)
+            {
+                if (subscriber.owner == &owner)
+                {
+                    subscriber.value = decode(device, subscriber);
+                }
+            }
+        }
+
+        bool isEnabled = std::ranges::any_of(device.subscribers,
+                                             &Subscriber::enabled);
+        if ((isEnabled != wasEnabled) && device.pollId)
+        {
+            PollScheduler::instance().setEnabled(*device.pollId, isEnabled);
+        }
+    }
+}
+
+std::optional<uint16_t> CpldDevices::getValue(const ButtonIface& owner) const
+{
+    for (const auto& [key, device] : devices)
+    {
+        for (const auto& subscriber : device.subscribers)
+        {
+            if (subscriber.owner == &owner)
+            {
+                return subscriber.value;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+CpldRegisters::~CpldRegisters()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+int CpldRegisters::open(const std::string& path, uint16_t address)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+    this->address = address;
+
+    struct stat status{};
+    standIn = (::fstat(fd, &status) == 0) && S_ISREG(status.st_mode);
+    return 0;
+}
+
+void CpldRegisters::plan(std::vector<uint8_t> offsets)
+{
+    std::ranges::sort(offsets);
+
+    runs.clear();
+    for (auto offset : offsets)
+    {
+        if (!runs.empty())
+        {
+            auto& run = runs.back();
+            if (offset - (run.first + run.count) < maxRunGap)
+            {
+                run.count = std::max<uint16_t>(run.count,
+                                               offset - run.first + 1);
+                continue;
+            }
+        }
+        runs.push_back({offset, 1});
+    }
+
+    // a transaction carries a limited number of messages, read the whole
+    // span of the registers instead
+    if ((runs.size() * 2) > I2C_RDWR_IOCTL_MAX_MSGS)
+    {
+        auto first = runs.front().first;
+        auto last = runs.back().first + runs.back().count;
+        runs = {{first, static_cast<uint16_t>(last - first)}};
+    }
+
+    // each run is the write of its first register then a repeated start
+    // read, the buffers point into the runs and the registers
+    messages.clear();
+    for (auto& run : runs)
+    {
+        messages.push_back({address, 0, 1, &run.first});
+        messages.push_back(
+            {address, I2C_M_RD, run.count, &registers[run.first]});
+    }
+}
+
+bool CpldRegisters::read()
+{
+    if (standIn)
+    {
+        for (const auto& run : runs)
+        {
+            auto offset = static_cast<off_t>((address << 8) | run.first);
+            if (::pread(fd, &registers[run.first], run.count, offset) !=
+                run.count)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    i2c_rdwr_ioctl_data transaction{messages.data(),
+                                    static_cast<uint32_t>(messages.size())};
+    return ::ioctl(fd, I2C_RDWR, &transaction) >= 0;
+}
+
+void CpldDevices::plan(Device& device)
+{
+    std::vector<uint8_t> offsets;
+    for (const auto& subscriber : device.subscribers)
+    {
+        offsets.push_back(subscriber.offset);
+    }
+    device.registers.plan(std::move(offsets));
+}
+
+bool CpldDevices::poll(Device& device)
+{
+    if (!device.registers.read())
+    {
+        // e.g. the cpld is held in reset, its buttons recover once it is back
+        lg2::error("{PATH}: failed to read address {ADDRESS}: {ERROR}",
+                   "PATH", device.path, "ADDRESS", device.key.second, "ERROR",
+                   errno);
+        std::vector<ButtonIface*> owners;
+        for (const auto& subscriber : device.subscribers)
+        {
+            owners.push_back(subscriber.owner);
+        }
+
+        // each degraded button removes itself, the last one would close the
+        // device this poll is still running on
+        polling = &device;
+        for (auto* owner : owners)
+        {
+            owner->degrade();
+        }
+        polling = nullptr;
+        if (device.subscribers.empty())
+        {
+            close(device);
+        }
+        return false;
+    }
+
+    // the handlers don't add or remove buttons, the subscribers are stable
+    auto now = std::chrono::steady_clock::now();
+    bool changed = false;
+    for (auto& subscriber : device.subscribers)
+    {
+        auto value = decode(device, subscriber);
+        if (!subscriber.enabled || (value == subscriber.value) ||
+            (value == CpldDecoder::invalidValue))
+        {
+            continue;
+        }
+
+        subscriber.value = value;
+        GpioEdge edge{toCpldState(value), now};
+        subscriber.owner->injectEdges(device.registers.getFd(),
+                                      std::span(&edge, 1));
+        changed = true;
+    }
+    return changed;
+}
+
+void CpldDevices::close(Device& device)
+{
+    if (device.pollId)
+    {
+        PollScheduler::instance().remove(*device.pollId);
+    }
+    // closes the fd
+    devices.erase(device.key);
+}
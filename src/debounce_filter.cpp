@@ -0,0 +1,70 @@
+#include "debounce_filter.hpp"
+
+#include <algorithm>
+
+DebounceFilter::DebounceFilter(std::chrono::milliseconds period,
+                               Resample resample) :
+    period(period), resample(std::move(resample)), timer([this]() {
+        settled();
+    })
+{}
+
+void DebounceFilter::track(int fd, GpioState state)
+{
+    lines.push_back({fd, state, std::chrono::steady_clock::now()});
+}
+
+void DebounceFilter::clear()
+{
+    lines.clear();
+    timer.setEnabled(false);
+}
+
+std::span<const GpioEdge> DebounceFilter::filter(
+    int fd, std::span<const GpioEdge> edges)
+{
+    auto line = std::ranges::find(lines, fd, &Line::fd);
+    if ((line == lines.end()) || edges.empty())
+    {
+        return edges;
+    }
+
+    if (!resampling)
+    {
+        // still bouncing, wait for a full quiet period
+        line->lastEdge = edges.back().time;
+        timer.restartOnce(period);
+        return {};
+    }
+
+    const auto& sample = edges.back();
+    if (sample.state == line->state)
+    {
+        return {};
+    }
+    line->state = sample.state;
+    settledEdge = {sample.state, line->lastEdge};
+    return std::span(&settledEdge, 1);
+}
+
+void DebounceFilter::settled()
+{
+    // a failed resample can clear the lines
+    std::vector<int> fds;
+    std::ranges::transform(lines, std::back_inserter(fds), &Line::fd);
+
+    resampling = true;
+    try
+    {
+        for (int fd : fds)
+        {
+            resample(fd);
+        }
+    }
+    catch (...)
+    {
+        resampling = false;
+        throw;
+    }
+    resampling = false;
+}
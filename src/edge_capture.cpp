@@ -0,0 +1,457 @@
+#include "edge_capture.hpp"
+
+#include "button_interface.hpp"
+#include "config.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+int EdgeCapture::add(sd_event* event, int fd, uint32_t events,
+                     const std::optional<GpioInfo>& gpio,
+                     const CpldDecoder* decoder, ButtonIface& owner)
+{
+    int ret = 0;
+    if (notifyFd < 0)
+    {
+        ret = start(event);
+    }
+    else if (!running)
+    {
+        ret = startThread();
+    }
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    auto& source = sources.emplace_back(fd, events, gpio, decoder, owner);
+
+    epoll_event epollEvent{};
+    epollEvent.events = events;
+    epollEvent.data.ptr = &source;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &epollEvent) < 0)
+    {
+        ret = -errno;
+        // the thread never saw it
+        sources.pop_back();
+        return ret;
+    }
+    return 0;
+}
+
+void EdgeCapture::remove(ButtonIface& owner, std::vector<int> fds)
+{
+    std::vector<Source*> removed;
+    for (auto& source : sources)
+    {
+        if ((&source.owner == &owner) && source.active.exchange(false))
+        {
+            ::epoll_ctl(epollFd, EPOLL_CTL_DEL, source.fd, nullptr);
+            removed.push_back(&source);
+        }
+    }
+
+    if (removed.empty() || !running)
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+    else
+    {
+        // the thread may be handling an event epoll_wait returned before the
+        // fds left the set, it acknowledges once it is back out of its batch
+        auto request = ++removalRequests;
+        for (auto* source : removed)
+        {
+            source->removedBy = request;
+        }
+        for (int fd : fds)
+        {
+            if (fd < 0)
+            {
+                continue;
+            }
+            // releases the line or the file now, the number stays taken
+            ::dup3(nullFd, fd, O_CLOEXEC);
+            closing.emplace_back(request, fd);
+        }
+        ::eventfd_write(wakeFd, 1);
+    }
+
+    if (!dispatching)
+    {
+        eraseRemoved();
+    }
+}
+
+void EdgeCapture::eraseRemoved()
+{
+    // a stopped thread doesn't hold any event
+    uint64_t done = running ? removalsDone.load() : removalRequests.load();
+
+    auto acknowledged = std::ranges::partition(
+        closing, [done](const auto& fd) { return fd.first > done; });
+    for (const auto& fd : acknowledged)
+    {
+        ::close(fd.second);
+    }
+    closing.erase(acknowledged.begin(), acknowledged.end());
+
+    // a queued edge may still point to a removed source
+    if (ring.empty())
+    {
+        sources.remove_if([done](const Source& source) {
+            return !source.active && (source.removedBy <= done);
+        });
+    }
+}
+
+void EdgeCapture::degradeAll()
+{
+    lg2::error("Edge capture thread stopped, degrading its buttons");
+    for (auto& source : sources)
+    {
+        // removes all the sources of the owner
+        if (source.active)
+        {
+            source.owner.degrade();
+        }
+    }
+}
+
+void EdgeCapture::setEnabled(ButtonIface& owner, bool enabled)
+{
+    for (auto& source : sources)
+    {
+        if ((&source.owner != &owner) || !source.active ||
+            (source.enabled.exchange(enabled) == enabled))
+        {
+            continue;
+        }
+
+        if (!enabled)
+        {
+            ::epoll_ctl(epollFd, EPOLL_CTL_DEL, source.fd, nullptr);
+            continue;
+        }
+        epoll_event epollEvent{};
+        epollEvent.events = source.events;
+        epollEvent.data.ptr = &source;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, source.fd, &epollEvent);
+    }
+}
+
+EdgeCapture::~EdgeCapture()
+{
+    if (thread.joinable())
+    {
+        thread.request_stop();
+        ::eventfd_write(wakeFd, 1);
+        thread.join();
+    }
+
+    for (const auto& fd : closing)
+    {
+        ::close(fd.second);
+    }
+    for (int fd : {epollFd, wakeFd, notifyFd, nullFd})
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+}
+
+int EdgeCapture::start(sd_event* event)
+{
+    wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    notifyFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    nullFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    // started again by the next add
+    auto closeAll = [this]() {
+        for (int* fd : {&wakeFd, &notifyFd, &nullFd})
+        {
+            if (*fd >= 0)
+            {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+    };
+    if ((wakeFd < 0) || (notifyFd < 0) || (nullFd < 0))
+    {
+        int ret = -errno;
+        lg2::error("Edge capture setup error: {ERROR}", "ERROR", ret);
+        closeAll();
+        return ret;
+    }
+
+    // the edges are already timestamped, but handing them over still goes
+    // before the bus
+    sd_event_source* source = nullptr;
+    int ret = sd_event_add_io(event, &source, notifyFd, EPOLLIN, dispatch,
+                              this);
+    if (ret < 0)
+    {
+        lg2::error("Edge capture failed to add to event loop: {ERROR}",
+                   "ERROR", ret);
+        closeAll();
+        return ret;
+    }
+    sd_event_source_set_priority(source,
+                                 static_cast<int64_t>(EventPriority::high));
+    sd_event_source_set_floating(source, 1);
+    sd_event_source_unref(source);
+
+    return startThread();
+}
+
+int EdgeCapture::startThread()
+{
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    if (epollFd >= 0)
+    {
+        ::close(epollFd);
+    }
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+    {
+        int ret = -errno;
+        lg2::error("Edge capture setup error: {ERROR}", "ERROR", ret);
+        return ret;
+    }
+
+    // a null source is the stop request
+    epoll_event epollEvent{};
+    epollEvent.events = EPOLLIN;
+    epollEvent.data.ptr = nullptr;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &epollEvent) < 0)
+    {
+        return -errno;
+    }
+
+    failed = false;
+    running = true;
+    thread = std::jthread([this](std::stop_token stop) {
+        bool ok = run(stop);
+
+        // the event loop degrades the buttons of a failed thread, and
+        // closes the fds it still held back
+        failed = !ok;
+        removalsDone = removalRequests.load();
+        running = false;
+        ::eventfd_write(notifyFd, 1);
+    });
+
+    int ret = 0;
+
+    if (EDGE_CAPTURE_PRIORITY > 0)
+    {
+        sched_param param{};
+        param.sched_priority = EDGE_CAPTURE_PRIORITY;
+        ret = ::pthread_setschedparam(thread.native_handle(), SCHED_FIFO,
+                                      &param);
+        if (ret != 0)
+        {
+            lg2::error("Edge capture SCHED_FIFO {PRIORITY} error: {ERROR}",
+                       "PRIORITY", EDGE_CAPTURE_PRIORITY, "ERROR", ret);
+        }
+    }
+
+    lg2::info("Started edge capture thread");
+    return 0;
+}
+
+bool EdgeCapture::run(std::stop_token stop)
+{
+    GpioLineReader reader;
+    std::array<epoll_event, 16> events;
+
+    while (!stop.stop_requested())
+    {
+        int count = ::epoll_wait(epollFd, events.data(), events.size(), -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            lg2::error("Edge capture epoll error: {ERROR}", "ERROR", errno);
+            return false;
+        }
+
+        bool queued = false;
+        bool woken = false;
+        for (const auto& epollEvent : std::span(events).first(count))
+        {
+            auto* source = static_cast<Source*>(epollEvent.data.ptr);
+            if (source == nullptr)
+            {
+                woken = true;
+                continue;
+            }
+            if (!source->active || !source->enabled)
+            {
+                continue;
+            }
+
+            auto edges = source->gpio
+                             ? reader.read(*source->gpio)
+                             : reader.readCpld(source->fd, *source->decoder);
+            if (!edges)
+            {
+                // don't spin on a broken fd, the button recovers it
+                ::epoll_ctl(epollFd, EPOLL_CTL_DEL, source->fd, nullptr);
+                lg2::error("Edge capture stopped on fd {FD}", "FD",
+                           source->fd);
+                GpioEdge error{GpioState::invalid,
+                               std::chrono::steady_clock::now()};
+                if (!ring.push({source, error}))
+                {
+                    // the resample fails on the broken fd as well
+                    dropped++;
+                    source->overflowed = true;
+                }
+                queued = true;
+                continue;
+            }
+
+            for (const auto& edge : *edges)
+            {
+                if (!ring.push({source, edge}))
+                {
+                    // the event loop reads the line again once it drained
+                    // the ring, so a lost release isn't missed
+                    dropped++;
+                    source->overflowed = true;
+                }
+                queued = true;
+            }
+        }
+
+        // no event of this batch is handled anymore, the fds removed before
+        // the wakeup can be closed
+        if (woken)
+        {
+            eventfd_t wakeups = 0;
+            ::eventfd_read(wakeFd, &wakeups);
+            removalsDone = removalRequests.load();
+        }
+
+        if (queued || woken)
+        {
+            ::eventfd_write(notifyFd, 1);
+        }
+    }
+    return true;
+}
+
+int EdgeCapture::dispatch(sd_event_source* /* es */, int fd,
+                          uint32_t /* revents */, void* userdata)
+{
+    auto* capture = static_cast<EdgeCapture*>(userdata);
+
+    eventfd_t count = 0;
+    ::eventfd_read(fd, &count);
+
+    // a button degraded below removes its sources, they are erased once the
+    // ring is drained
+    capture->dispatching = true;
+    while (auto captured = capture->ring.pop())
+    {
+        auto* source = captured->source;
+        if (!source->active || !source->enabled)
+        {
+            continue;
+        }
+        if (captured->edge.state == GpioState::invalid)
+        {
+            source->owner.degrade();
+            continue;
+        }
+        // already accounted for by a resample of the line
+        if (captured->edge.time <= source->resampledAt)
+        {
+            continue;
+        }
+        source->lastState = captured->edge.state;
+        source->owner.injectEdges(source->fd, std::span(&captured->edge, 1));
+    }
+
+    auto dropped = capture->dropped.exchange(0);
+    if (dropped > 0)
+    {
+        lg2::error("Edge capture queue full, {COUNT} edges dropped", "COUNT",
+                   dropped);
+        for (auto& source : capture->sources)
+        {
+            if (source.overflowed.exchange(false) && source.active &&
+                source.enabled)
+            {
+                capture->resample(source);
+            }
+        }
+    }
+
+    if (capture->failed.exchange(false))
+    {
+        capture->degradeAll();
+    }
+    capture->dispatching = false;
+
+    capture->eraseRemoved();
+    return 0;
+}
+
+void EdgeCapture::resample(Source& source)
+{
+    auto now = std::chrono::steady_clock::now();
+    GpioState state = GpioState::invalid;
+    if (source.gpio)
+    {
+        int value = readGpioValue(*source.gpio);
+        if (value >= 0)
+        {
+            state = toGpioState(source.gpio->polarity, value);
+        }
+    }
+    else if (auto edges = reader.readCpld(source.fd, *source.decoder))
+    {
+        if (edges->empty())
+        {
+            return;
+        }
+        state = edges->back().state;
+    }
+
+    if (state == GpioState::invalid)
+    {
+        source.owner.degrade();
+        return;
+    }
+
+    // the edges still queued from before now are stale
+    source.resampledAt = now;
+    if (state == source.lastState)
+    {
+        return;
+    }
+    source.lastState = state;
+    GpioEdge edge{state, now};
+    source.owner.injectEdges(source.fd, std::span(&edge, 1));
+}
@@ -0,0 +1,198 @@
+#include "fd_store.hpp"
+
+#include "config.hpp"
+#include "config_cache.hpp"
+#include "gpio.hpp"
+
+#include <systemd/sd-daemon.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+static std::string getFdName(const std::string& key, size_t index)
+{
+    return key + "-" + std::to_string(index);
+}
+
+FdStore::FdStore()
+{
+    char** names = nullptr;
+    int count = sd_listen_fds_with_names(1, &names);
+    if (count < 0)
+    {
+        lg2::error("Error reading the passed fds: {ERROR}", "ERROR", count);
+        return;
+    }
+
+    for (int index = 0; index < count; index++)
+    {
+        int fd = SD_LISTEN_FDS_START + index;
+        if ((names != nullptr) && (names[index] != nullptr))
+        {
+            passedFds.emplace(names[index], fd);
+        }
+        else
+        {
+            ::close(fd);
+        }
+    }
+
+    if (names != nullptr)
+    {
+        for (int index = 0; index < count; index++)
+        {
+            std::free(names[index]);
+        }
+        std::free(names);
+    }
+
+    if (count > 0)
+    {
+        lg2::info("Got {COUNT} fds from the fd store", "COUNT", count);
+    }
+
+    // FileDescriptorStoreMax of the service, systemd 254 and later
+    if (const char* max = std::getenv("FDSTORE"))
+    {
+        storeMax = std::strtoul(max, nullptr, 10);
+    }
+}
+
+std::string FdStore::getKey(const std::string& formFactorName,
+                            const nlohmann::json& definition)
+{
+    auto text = definition.dump();
+    return getKey(formFactorName, std::string_view(text));
+}
+
+std::string FdStore::getKey(const std::string& formFactorName,
+                            std::string_view definitionId)
+{
+    // the build options that change how the lines are opened are part of
+    // the key too
+    std::stringstream key;
+    key << formFactorName << "-" << std::hex << std::setw(16)
+        << std::setfill('0')
+        << hashText(std::string(definitionId) +
+                    (GPIO_CHARDEV ? "chardev" : "sysfs"));
+    return key.str();
+}
+
+bool FdStore::adopt(ButtonConfig& buttonCfg)
+{
+    if (buttonCfg.fdStoreKey.empty())
+    {
+        return false;
+    }
+
+    std::vector<int> fds;
+    for (auto fd = passedFds.find(getFdName(buttonCfg.fdStoreKey, 0));
+         fd != passedFds.end();
+         fd = passedFds.find(getFdName(buttonCfg.fdStoreKey, fds.size())))
+    {
+        fds.push_back(fd->second);
+    }
+    if (fds.empty())
+    {
+        return false;
+    }
+
+    int ret = -1;
+    if (buttonCfg.type == ConfigType::gpio)
+    {
+        ret = adoptGroupGpio(buttonCfg, fds);
+    }
+    else if ((buttonCfg.type == ConfigType::cpld) && (fds.size() == 1))
+    {
+        buttonCfg.cpld.cpldMappedFd = fds.front();
+        buttonCfg.fds = fds;
+        ret = 0;
+    }
+    if (ret < 0)
+    {
+        lg2::error("{NAME}: stored fds don't match, configuring", "NAME",
+                   buttonCfg.formFactorName);
+        return false;
+    }
+
+    for (size_t index = 0; index < fds.size(); index++)
+    {
+        passedFds.erase(getFdName(buttonCfg.fdStoreKey, index));
+    }
+    storedCounts[buttonCfg.fdStoreKey] = fds.size();
+
+    lg2::info("{NAME}: adopted {COUNT} fds", "NAME", buttonCfg.formFactorName,
+              "COUNT", fds.size());
+    return true;
+}
+
+void FdStore::releaseUnused()
+{
+    for (const auto& [name, fd] : passedFds)
+    {
+        std::string state = "FDSTOREREMOVE=1\nFDNAME=" + name;
+        sd_pid_notify_with_fds(0, 0, state.c_str(), nullptr, 0);
+        ::close(fd);
+    }
+    passedFds.clear();
+}
+
+void FdStore::store(const ButtonConfig& buttonCfg)
+{
+    if (buttonCfg.fdStoreKey.empty())
+    {
+        return;
+    }
+
+    // one name per message, systemd ignores a file it already holds
+    for (size_t index = 0; index < buttonCfg.fds.size(); index++)
+    {
+        std::string state = "FDSTORE=1\nFDNAME=" +
+                            getFdName(buttonCfg.fdStoreKey, index);
+        int ret = sd_pid_notify_with_fds(0, 0, state.c_str(),
+                                         &buttonCfg.fds[index], 1);
+        if (ret < 0)
+        {
+            lg2::error("{NAME}: error storing fd: {ERROR}", "NAME",
+                       buttonCfg.formFactorName, "ERROR", ret);
+            return;
+        }
+    }
+    storedCounts[buttonCfg.fdStoreKey] = buttonCfg.fds.size();
+
+    // systemd drops the fds past the limit, their buttons are configured
+    // from scratch after a restart
+    size_t total = 0;
+    for (const auto& [key, count] : storedCounts)
+    {
+        total += count;
+    }
+    if (storeMax && (total > *storeMax) && !overLimit)
+    {
+        lg2::error("{COUNT} fds stored, over the FileDescriptorStoreMax of "
+                   "{MAX}",
+                   "COUNT", total, "MAX", *storeMax);
+    }
+    overLimit = storeMax && (total > *storeMax);
+}
+
+void FdStore::remove(const ButtonConfig& buttonCfg)
+{
+    auto stored = storedCounts.find(buttonCfg.fdStoreKey);
+    if (stored == storedCounts.end())
+    {
+        return;
+    }
+
+    for (size_t index = 0; index < stored->second; index++)
+    {
+        std::string state = "FDSTOREREMOVE=1\nFDNAME=" +
+                            getFdName(buttonCfg.fdStoreKey, index);
+        sd_pid_notify_with_fds(0, 0, state.c_str(), nullptr, 0);
+    }
+    storedCounts.erase(stored);
+}
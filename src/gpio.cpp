@@ -19,116 +19,896 @@
 
 #include <error.h>
 #include <fcntl.h>
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
 #include <unistd.h>
 
+#include <gpioplus/chip.hpp>
 #include <gpioplus/utility/aspeed.hpp>
 #include <nlohmann/json.hpp>
 #include <phosphor-logging/lg2.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 
 const std::string gpioDev = "/sys/class/gpio";
 namespace fs = std::filesystem;
-std::unordered_map<GpioPolarity, GPIOBufferValue> GpioValueMap = {
-    {GpioPolarity::activeLow, {'0', '1'}},
-    {GpioPolarity::activeHigh, {'1', '0'}}};
+void setGpioState(const GpioInfo& gpio, GpioState state)
+{
+    setGroupGpioState(std::span(&gpio, 1), std::span(&state, 1));
+}
 
-void setGpioState(int fd, GpioPolarity polarity, GpioState state)
+GpioState getGpioState(const GpioInfo& gpio)
 {
-    char writeBuffer;
+    int result = readGpioValue(gpio);
+    if (result < 0)
+    {
+        throw std::runtime_error("GPIO read failed");
+    }
+    return toGpioState(gpio.polarity, result);
+}
 
-    if (state == GpioState::assert)
+void setGroupGpioState(std::span<const GpioInfo> gpios,
+                       std::span<const GpioState> states)
+{
+    if (!GPIO_CHARDEV)
     {
-        writeBuffer = GpioValueMap[polarity].assert;
+        for (size_t index = 0; index < gpios.size(); index++)
+        {
+            if (states[index] == GpioState::invalid)
+            {
+                continue;
+            }
+
+            int fd = gpios[index].fd;
+            char writeBuffer =
+                toGpioLevel(gpios[index].polarity, states[index]) ? '1' : '0';
+
+            auto result = ::write(fd, &writeBuffer, sizeof(writeBuffer));
+            if (result < 0)
+            {
+                lg2::error("GPIO write error {GPIOFD} : {ERRORNO}", "GPIOFD",
+                           fd, "ERRORNO", errno);
+            }
+        }
+        return;
     }
-    else
+
+    // collect the lines of each line request and set them in one go
+    std::vector<std::pair<int, gpio_v2_line_values>> requests;
+    for (size_t index = 0; index < gpios.size(); index++)
     {
-        writeBuffer = GpioValueMap[polarity].deassert;
+        if (states[index] == GpioState::invalid)
+        {
+            continue;
+        }
+
+        const auto& gpio = gpios[index];
+        auto request = std::ranges::find(
+            requests, gpio.fd, &decltype(requests)::value_type::first);
+        if (request == requests.end())
+        {
+            request = requests.insert(request, {gpio.fd, {}});
+        }
+
+        uint64_t bit = 1ULL << gpio.requestIndex;
+        request->second.mask |= bit;
+        if (toGpioLevel(gpio.polarity, states[index]))
+        {
+            request->second.bits |= bit;
+        }
     }
 
-    auto result = ::write(fd, &writeBuffer, sizeof(writeBuffer));
-    if (result < 0)
+    for (auto& [fd, values] : requests)
     {
-        lg2::error("GPIO write error {GPIOFD} : {ERRORNO}", "GPIOFD", fd,
-                   "ERRORNO", errno);
+        if (::ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0)
+        {
+            lg2::error("GPIO set values error {GPIOFD} : {ERRORNO}", "GPIOFD",
+                       fd, "ERRORNO", errno);
+        }
     }
-    return;
 }
-GpioState getGpioState(int fd, GpioPolarity polarity)
+
+int readGroupGpioValues(std::span<const GpioInfo> gpios,
+                        std::span<uint8_t> values)
 {
-    int result = -1;
-    char readBuffer = '0';
+    if (!GPIO_CHARDEV)
+    {
+        for (size_t index = 0; index < gpios.size(); index++)
+        {
+            char readBuffer = '0';
+            int fd = gpios[index].fd;
 
-    result = ::lseek(fd, 0, SEEK_SET);
+            if (::pread(fd, &readBuffer, sizeof(readBuffer), 0) < 0)
+            {
+                lg2::error("GPIO read error {GPIOFD}: {ERRORNO}", "GPIOFD", fd,
+                           "ERRORNO", errno);
+                return -1;
+            }
+            values[index] = (readBuffer == '0') ? 0 : 1;
+        }
+        return 0;
+    }
 
-    if (result < 0)
+    // sample every line of a line request with a single ioctl, so all
+    // the lines of a group are read at the same instant
+    for (size_t index = 0; index < gpios.size(); index++)
     {
-        lg2::error("GPIO lseek error {GPIOFD}: {ERROR}", "GPIOFD", fd, "ERROR",
-                   errno);
-        return GpioState::invalid;
+        int fd = gpios[index].fd;
+        if (std::ranges::any_of(gpios.first(index),
+                                [fd](const auto& gpio) { return gpio.fd == fd; }))
+        {
+            continue;
+        }
+
+        gpio_v2_line_values lineValues{};
+        for (const auto& gpio : gpios.subspan(index))
+        {
+            if (gpio.fd == fd)
+            {
+                lineValues.mask |= 1ULL << gpio.requestIndex;
+            }
+        }
+
+        if (::ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lineValues) < 0)
+        {
+            lg2::error("GPIO get values error {GPIOFD}: {ERRORNO}", "GPIOFD",
+                       fd, "ERRORNO", errno);
+            return -1;
+        }
+
+        for (size_t line = index; line < gpios.size(); line++)
+        {
+            if (gpios[line].fd == fd)
+            {
+                values[line] =
+                    (lineValues.bits >> gpios[line].requestIndex) & 1;
+            }
+        }
     }
+    return 0;
+}
 
-    result = ::read(fd, &readBuffer, sizeof(readBuffer));
-    if (result < 0)
+int readGpioValue(const GpioInfo& gpio)
+{
+    uint8_t value = 0;
+    if (readGroupGpioValues(std::span(&gpio, 1), std::span(&value, 1)) < 0)
+    {
+        return -1;
+    }
+    return value;
+}
+
+GpioLineReader::Edges GpioLineReader::readValue(int fd,
+                                                GpioPolarity polarity)
+{
+    auto now = std::chrono::steady_clock::now();
+    char readBuffer = '0';
+
+    // pread() rewinds and reads in one call, which also rearms POLLPRI
+    if (::pread(fd, &readBuffer, sizeof(readBuffer), 0) < 0)
     {
         lg2::error("GPIO read error {GPIOFD}: {ERRORNO}", "GPIOFD", fd,
                    "ERRORNO", errno);
-        throw std::runtime_error("GPIO read failed");
+        return std::nullopt;
     }
-    // read the gpio state for the io event received
-    GpioState gpioState = (readBuffer == GpioValueMap[polarity].assert)
-                              ? (GpioState::assert)
-                              : (GpioState::deassert);
-    return gpioState;
+
+    edges[0] = {toGpioState(polarity, readBuffer == '1'), now};
+    return std::span(edges).first(1);
 }
 
-uint32_t getGpioBase()
+GpioLineReader::Edges GpioLineReader::readCpld(int fd,
+                                               const CpldDecoder& decoder)
 {
-    // Look for a /sys/class/gpio/gpiochip*/label file
-    // with a value of GPIO_BASE_LABEL_NAME.  Then read
-    // the base value from the 'base' file in that directory.
-#ifdef LOOKUP_GPIO_BASE
-    for (auto& f : fs::directory_iterator(gpioDev))
+    auto now = std::chrono::steady_clock::now();
+    auto value = decoder.read(fd);
+    if (!value)
     {
-        std::string path{f.path()};
-        if (path.find("gpiochip") == std::string::npos)
+        return std::nullopt;
+    }
+    if (*value == CpldDecoder::invalidValue)
+    {
+        return std::span(edges).first(0);
+    }
+
+    edges[0] = {toCpldState(*value), now};
+    return std::span(edges).first(1);
+}
+
+GpioLineReader::Edges GpioLineReader::read(const GpioInfo& gpio)
+{
+    if (!GPIO_CHARDEV)
+    {
+        return readValue(gpio.fd, gpio.polarity);
+    }
+
+    // Drain every queued event with a single read. Line event timestamps
+    // are taken from CLOCK_MONOTONIC, the same clock as steady_clock.
+    std::array<gpio_v2_line_event, maxGpioEdges> events;
+
+    auto result = ::read(gpio.fd, events.data(), sizeof(events));
+    if (result < 0)
+    {
+        if (errno == EAGAIN)
+        {
+            return std::span(edges).first(0);
+        }
+        lg2::error("GPIO event read error {GPIOFD}: {ERRORNO}", "GPIOFD",
+                   gpio.fd, "ERRORNO", errno);
+        return std::nullopt;
+    }
+
+    size_t count = result / sizeof(events[0]);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t level =
+            (events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+        edges[i].state = toGpioState(gpio.polarity, level);
+        edges[i].time = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(events[i].timestamp_ns)));
+    }
+    return std::span(edges).first(count);
+}
+
+GpioChipIndex::GpioChipIndex()
+{
+    try
+    {
+        // sysfs knows the global base of each chip
+        if (fs::exists(gpioDev))
+        {
+            for (auto& f : fs::directory_iterator(gpioDev))
+            {
+                std::string path{f.path()};
+                if (path.find("gpiochip") == std::string::npos)
+                {
+                    continue;
+                }
+
+                std::string label;
+                uint32_t base = 0;
+                GpioChipInfo chip{};
+                chip.chipId = invalidGpioChip;
+
+                std::getline(std::ifstream{path + "/label"}, label);
+                std::ifstream{path + "/base"} >> base;
+                std::ifstream{path + "/ngpio"} >> chip.ngpio;
+                chip.base = base;
+
+                // the parent device holds the gpiochipN node of the chardev
+                for (auto& d : fs::directory_iterator(path + "/device"))
+                {
+                    std::string name = d.path().filename();
+                    if (name.starts_with("gpiochip"))
+                    {
+                        chip.chipId = std::stoul(name.substr(8));
+                        chip.devPath = "/dev/" + name;
+                        break;
+                    }
+                }
+
+                chips.emplace(label, chip);
+            }
+        }
+
+        // chips without a sysfs entry are only usable by line requests
+        for (auto& f : fs::directory_iterator("/dev"))
+        {
+            std::string name = f.path().filename();
+            if (!name.starts_with("gpiochip"))
+            {
+                continue;
+            }
+
+            unsigned chipId = std::stoul(name.substr(8));
+            if (std::ranges::any_of(chips, [chipId](const auto& chip) {
+                    return chip.second.chipId == chipId;
+                }))
+            {
+                continue;
+            }
+
+            gpioplus::Chip gpioChip(chipId);
+            const auto& info = gpioChip.getChipInfo();
+            chips.emplace(info.label, GpioChipInfo{std::nullopt, info.lines,
+                                                   chipId, f.path()});
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Error indexing gpiochips: {ERROR}", "ERROR", e);
+    }
+
+    lg2::info("Found {COUNT} gpiochips", "COUNT", chips.size());
+}
+
+const GpioChipInfo* GpioChipIndex::find(const std::string& label) const
+{
+    auto chip = chips.find(label);
+    return (chip != chips.end()) ? &chip->second : nullptr;
+}
+
+std::string GpioChipIndex::getChipsKey() const
+{
+    std::vector<std::string> layout;
+    for (const auto& [label, chip] : chips)
+    {
+        // the caches hold the chip numbers and the sysfs numbers of the
+        // lines, a chip probed in another order invalidates them too
+        layout.push_back(
+            label + ":" + std::to_string(chip.ngpio) + ":" +
+            std::to_string(chip.chipId) + ":" +
+            (chip.base ? std::to_string(*chip.base) : std::string("-")));
+    }
+    std::ranges::sort(layout);
+
+    // the line names come from the devicetree of the firmware, which an
+    // update can change along with the kernel build
+    std::string key;
+    utsname kernel{};
+    if (::uname(&kernel) == 0)
+    {
+        key = std::string(kernel.release) + " " + kernel.version + ";";
+    }
+    for (const auto& chip : layout)
+    {
+        key += chip + ";";
+    }
+    return key;
+}
+
+void GpioChipIndex::indexLines() const
+{
+    lines.emplace();
+    auto key = getChipsKey();
+
+    try
+    {
+        std::ifstream cacheFile{GPIO_LINE_CACHE};
+        if (cacheFile)
+        {
+            auto cache = nlohmann::json::parse(cacheFile);
+            if (cache.at("chips") == key)
+            {
+                for (const auto& [name, line] : cache.at("lines").items())
+                {
+                    const auto* chip = find(line.at(0).get<std::string>());
+                    auto offset = line.at(1).get<uint32_t>();
+                    if (chip != nullptr)
+                    {
+                        lines->emplace(name, GpioLine{chip, offset});
+                    }
+                }
+                lg2::info("Loaded {COUNT} gpio line names from {PATH}",
+                          "COUNT", lines->size(), "PATH", GPIO_LINE_CACHE);
+                return;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Error loading {PATH}: {ERROR}", "PATH", GPIO_LINE_CACHE,
+                   "ERROR", e);
+        lines->clear();
+    }
+
+    nlohmann::json names = nlohmann::json::object();
+    for (const auto& [label, chip] : chips)
+    {
+        if (chip.chipId == invalidGpioChip)
         {
             continue;
         }
 
-        std::ifstream labelStream{path + "/label"};
-        std::string label;
-        labelStream >> label;
+        try
+        {
+            gpioplus::Chip gpioChip(chip.chipId);
+            for (uint32_t offset = 0; offset < chip.ngpio; offset++)
+            {
+                auto name = gpioChip.getLineInfo(offset).name;
+                // a name used twice keeps its first line
+                if (!name.empty() &&
+                    lines->emplace(name, GpioLine{&chip, offset}).second)
+                {
+                    names[name] = {label, offset};
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Error reading line names of {LABEL}: {ERROR}",
+                       "LABEL", label, "ERROR", e);
+        }
+    }
+
+    // write a copy first, a crash never leaves a truncated cache
+    try
+    {
+        fs::path path{GPIO_LINE_CACHE};
+        fs::create_directories(path.parent_path());
+
+        auto tmpPath = path;
+        tmpPath += ".tmp";
+        std::ofstream{tmpPath} << nlohmann::json{{"chips", key},
+                                                 {"lines", names}};
+        fs::rename(tmpPath, path);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Error writing {PATH}: {ERROR}", "PATH", GPIO_LINE_CACHE,
+                   "ERROR", e);
+    }
+
+    lg2::info("Indexed {COUNT} gpio line names", "COUNT", lines->size());
+}
+
+const GpioLine* GpioChipIndex::findLine(const std::string& name) const
+{
+    if (!lines)
+    {
+        indexLines();
+    }
+
+    auto line = lines->find(name);
+    return (line != lines->end()) ? &line->second : nullptr;
+}
 
-        if (label == GPIO_BASE_LABEL_NAME)
+const GpioChipInfo* GpioChipIndex::find(uint32_t number) const
+{
+    for (const auto& [label, chip] : chips)
+    {
+        if (chip.base && (number >= *chip.base) &&
+            (number < *chip.base + chip.ngpio))
+        {
+            return &chip;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief checks that the gpiochip line of a gpio is known, it is set by
+ * resolveGpio through the gpiochip index.
+ * @return int returns 0 when chipId and offset of gpioConfig are valid
+ */
+static int getGpioChipLine(GpioInfo& gpioConfig)
+{
+    if (gpioConfig.chipId == invalidGpioChip)
+    {
+        // a config that did not go through resolveGpio
+        const auto* chip = GpioChipIndex::instance().find(gpioConfig.number);
+        if ((chip == nullptr) || (chip->chipId == invalidGpioChip))
         {
-            uint32_t base;
-            std::ifstream baseStream{path + "/base"};
-            baseStream >> base;
-            return base;
+            lg2::error("Could not find gpiochip of gpio-{NUM}", "NUM",
+                       gpioConfig.number);
+            return -1;
         }
+        gpioConfig.chipId = chip->chipId;
+        gpioConfig.offset = gpioConfig.number - *chip->base;
     }
+    return 0;
+}
+
+// line request flags matching the "direction" of a gpio config
+static uint64_t getGpioLineFlags(const std::string& direction)
+{
+    if (direction == "out")
+    {
+        return GPIO_V2_LINE_FLAG_OUTPUT;
+    }
+    if (direction == "both")
+    {
+        return GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+               GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    }
+    return GPIO_V2_LINE_FLAG_INPUT;
+}
 
-    lg2::error("Could not find GPIO base");
+/**
+ * @brief sets the flags of the line at bit of a line config, through a
+ * flags attribute when they differ from the flags of the first line.
+ * @return false when no attribute is left
+ */
+static bool setGpioLineFlags(gpio_v2_line_config& lineConfig, uint64_t flags,
+                             uint64_t bit)
+{
+    if (flags == lineConfig.flags)
+    {
+        return true;
+    }
+
+    size_t attr = 0;
+    while (attr < lineConfig.num_attrs &&
+           lineConfig.attrs[attr].attr.flags != flags)
+    {
+        attr++;
+    }
+    if (attr == lineConfig.num_attrs)
+    {
+        // keep the last attributes for the output values and the debounce
+        // period
+        if (attr >= GPIO_V2_LINE_NUM_ATTRS_MAX - 2)
+        {
+            return false;
+        }
+        lineConfig.attrs[attr].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+        lineConfig.attrs[attr].attr.flags = flags;
+        lineConfig.num_attrs++;
+    }
+    lineConfig.attrs[attr].mask |= bit;
+    return true;
+}
+
+/**
+ * @brief requests lines of one gpiochip with a single line request.
+ * The line request fd replaces the sysfs value fds, it is shared by all
+ * the lines and reports gpio_v2_line_event records for the lines that
+ * are configured for "both" edges.
+ * @return int returns 0 on successful line request
+ */
+static int requestGpioLines(std::span<GpioInfo* const> gpios,
+                            ButtonConfig& buttonIFConfig)
+{
+    auto& first = *gpios.front();
+
+    if (gpios.size() > GPIO_V2_LINES_MAX)
+    {
+        lg2::error("{NAME}: too many lines on gpiochip{CHIP}", "NAME",
+                   buttonIFConfig.formFactorName, "CHIP", first.chipId);
+        return -1;
+    }
+
+    try
+    {
+        gpioplus::Chip chip(first.chipId);
+
+        gpio_v2_line_request request{};
+        request.num_lines = gpios.size();
+        std::strncpy(request.consumer, buttonIFConfig.formFactorName.c_str(),
+                     sizeof(request.consumer) - 1);
+
+        // an output line is requested with its direction as is, so that
+        // its level can be read, then switched to output at that level:
+        // requesting it driven would glitch a line such as the serial uart
+        // mux select, as sysfs never did
+        auto requestFlags = [](uint64_t flags) {
+            return (flags & GPIO_V2_LINE_FLAG_OUTPUT) ? 0 : flags;
+        };
+
+        // the first line sets the request flags, lines with another
+        // direction get a flags attribute
+        gpio_v2_line_config lineConfig{};
+        lineConfig.flags = getGpioLineFlags(first.direction);
+        auto& requestConfig = request.config;
+        requestConfig.flags = requestFlags(lineConfig.flags);
+
+        gpio_v2_line_config_attribute outputValues{};
+        outputValues.attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+
+        // the kernel debounces the inputs, so only settled edges are read
+        gpio_v2_line_config_attribute debounce{};
+        debounce.attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+        debounce.attr.debounce_period_us =
+            std::chrono::microseconds(buttonIFConfig.debounce).count();
+
+        for (size_t index = 0; index < gpios.size(); index++)
+        {
+            const auto& gpio = *gpios[index];
+            uint64_t bit = 1ULL << index;
+            uint64_t flags = getGpioLineFlags(gpio.direction);
+
+            request.offsets[index] = gpio.offset;
+
+            if (!setGpioLineFlags(lineConfig, flags, bit) ||
+                !setGpioLineFlags(requestConfig, requestFlags(flags), bit))
+            {
+                return -1;
+            }
+
+            if (flags & GPIO_V2_LINE_FLAG_OUTPUT)
+            {
+                outputValues.mask |= bit;
+            }
+            else if (debounce.attr.debounce_period_us)
+            {
+                debounce.mask |= bit;
+            }
+        }
+
+        if (debounce.mask)
+        {
+            requestConfig.attrs[requestConfig.num_attrs++] = debounce;
+        }
+
+        if (::ioctl(*chip.getFd(), GPIO_V2_GET_LINE_IOCTL, &request) < 0)
+        {
+            lg2::error("gpiochip{CHIP} line {OFFSET} request error: {ERROR}",
+                       "CHIP", first.chipId, "OFFSET", first.offset, "ERROR",
+                       errno);
+            return -1;
+        }
+
+        if (outputValues.mask)
+        {
+            gpio_v2_line_values levels{};
+            levels.mask = outputValues.mask;
+            if (::ioctl(request.fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &levels) < 0)
+            {
+                lg2::error("gpiochip{CHIP} line {OFFSET} read error: {ERROR}",
+                           "CHIP", first.chipId, "OFFSET", first.offset,
+                           "ERROR", errno);
+                ::close(request.fd);
+                return -1;
+            }
+            outputValues.attr.values = levels.bits & levels.mask;
+
+            lineConfig.attrs[lineConfig.num_attrs++] = outputValues;
+            if (debounce.mask)
+            {
+                lineConfig.attrs[lineConfig.num_attrs++] = debounce;
+            }
+            if (::ioctl(request.fd, GPIO_V2_LINE_SET_CONFIG_IOCTL,
+                        &lineConfig) < 0)
+            {
+                lg2::error(
+                    "gpiochip{CHIP} line {OFFSET} output config error: {ERROR}",
+                    "CHIP", first.chipId, "OFFSET", first.offset, "ERROR",
+                    errno);
+                ::close(request.fd);
+                return -1;
+            }
+        }
+
+        // never block the event loop on a spurious wakeup
+        ::fcntl(request.fd, F_SETFL, ::fcntl(request.fd, F_GETFL) | O_NONBLOCK);
+
+        for (size_t index = 0; index < gpios.size(); index++)
+        {
+            gpios[index]->fd = request.fd;
+            gpios[index]->requestIndex = index;
+        }
+        buttonIFConfig.fds.push_back(request.fd);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("{NUM} error in requesting line: {ERROR}", "NUM",
+                   first.number, "ERROR", e);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief requests all the lines of a group with one line request per
+ * gpiochip, so a group on a single chip is served by one fd.
+ * @return int returns 0 on successful line requests
+ */
+static int configGroupGpioLines(ButtonConfig& buttonIFConfig)
+{
+    std::vector<unsigned> chips;
+
+    for (auto& gpioCfg : buttonIFConfig.gpios)
+    {
+        try
+        {
+            if (getGpioChipLine(gpioCfg) < 0)
+            {
+                return -1;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("{NUM} error in finding gpiochip: {ERROR}", "NUM",
+                       gpioCfg.number, "ERROR", e);
+            return -1;
+        }
+
+        if (std::ranges::find(chips, gpioCfg.chipId) == chips.end())
+        {
+            chips.push_back(gpioCfg.chipId);
+        }
+    }
+
+    std::vector<GpioInfo*> chipLines;
+    for (auto chipId : chips)
+    {
+        chipLines.clear();
+        for (auto& gpioCfg : buttonIFConfig.gpios)
+        {
+            if (gpioCfg.chipId == chipId)
+            {
+                chipLines.push_back(&gpioCfg);
+            }
+        }
+
+        if (requestGpioLines(chipLines, buttonIFConfig) < 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t getGpioBase(const std::string& chipLabel)
+{
+    // Look up the gpiochip with a label of chipLabel, by default
+    // GPIO_BASE_LABEL_NAME, and use its base value.
+#ifdef LOOKUP_GPIO_BASE
+    const auto* chip = GpioChipIndex::instance().find(chipLabel);
+    if ((chip != nullptr) && chip->base)
+    {
+        return *chip->base;
+    }
+
+    lg2::error("Could not find GPIO base of {LABEL}", "LABEL", chipLabel);
     throw std::runtime_error("Could not find GPIO base!");
 #else
     return 0;
 #endif
 }
 
-uint32_t getGpioNum(const std::string& gpioPin)
+uint32_t getGpioNum(const std::string& gpioPin, const std::string& chipLabel)
 {
     // gpioplus promises that they will figure out how to easily
     // support multiple BMC vendors when the time comes.
     auto offset = gpioplus::utility::aspeed::nameToOffset(gpioPin);
 
-    return getGpioBase() + offset;
+    return getGpioBase(chipLabel) + offset;
+}
+
+bool resolveGpio(GpioInfo& gpio, const GpioSpec& spec)
+{
+    const auto& chipIndex = GpioChipIndex::instance();
+
+    if (!spec.lineName.empty())
+    {
+        std::string name{spec.lineName};
+        const auto* line = chipIndex.findLine(name);
+
+        // sysfs can only export the lines of a chip with a known base
+        if ((line == nullptr) || (!GPIO_CHARDEV && !line->chip->base))
+        {
+            lg2::error("GPIO line {NAME} not found", "NAME", name);
+            return false;
+        }
+
+        gpio.chipId = line->chip->chipId;
+        gpio.offset = line->offset;
+        gpio.number = line->chip->base.value_or(0) + line->offset;
+    }
+    else if (spec.pinOffset)
+    {
+        std::string label{spec.chipLabel};
+        const auto* chip = chipIndex.find(label);
+
+        if (GPIO_CHARDEV && (chip != nullptr))
+        {
+            // a line request doesn't need the sysfs base, the number is
+            // only used in logs
+            gpio.offset = *spec.pinOffset;
+            gpio.number = chip->base.value_or(0) + gpio.offset;
+            gpio.chipId = chip->chipId;
+        }
+        else
+        {
+            gpio.number = getGpioBase(label) + *spec.pinOffset;
+        }
+    }
+    else
+    {
+        gpio.number = spec.number;
+    }
+
+    if (gpio.chipId == invalidGpioChip)
+    {
+        const auto* chip = chipIndex.find(gpio.number);
+        if (chip != nullptr)
+        {
+            gpio.chipId = chip->chipId;
+            gpio.offset = gpio.number - *chip->base;
+        }
+    }
+    return true;
+}
+
+bool resolveGpio(GpioInfo& gpio, const nlohmann::json& gpioConfig)
+{
+    GpioSpec spec;
+    std::string label;
+    if (gpioConfig.contains("line_name"))
+    {
+        spec.lineName =
+            gpioConfig.at("line_name").get_ref<const std::string&>();
+    }
+    else if (gpioConfig.contains("pin"))
+    {
+        // When "pin" key is used, parse as alphanumeric
+        label =
+            gpioConfig.value("chip_label", std::string(GPIO_BASE_LABEL_NAME));
+        spec.chipLabel = label;
+        spec.pinOffset = gpioplus::utility::aspeed::nameToOffset(
+            gpioConfig.at("pin").get<std::string>());
+    }
+    else
+    {
+        // Without "pin", "num" is assumed and parsed as an integer
+        spec.number = gpioConfig.at("num").get<uint32_t>();
+    }
+    return resolveGpio(gpio, spec);
+}
+
+int adoptGroupGpio(ButtonConfig& buttonCfg, std::span<const int> fds)
+{
+    auto& gpios = buttonCfg.gpios;
+
+    if (!GPIO_CHARDEV)
+    {
+        if (fds.size() != gpios.size())
+        {
+            return -1;
+        }
+        for (size_t index = 0; index < gpios.size(); index++)
+        {
+            gpios[index].fd = fds[index];
+        }
+        buttonCfg.fds.assign(fds.begin(), fds.end());
+        return 0;
+    }
+
+    // a line request per gpiochip, in the order of their first line, the
+    // lines indexed in the order of the config
+    std::vector<unsigned> chips;
+    for (const auto& gpio : gpios)
+    {
+        if (std::ranges::find(chips, gpio.chipId) == chips.end())
+        {
+            chips.push_back(gpio.chipId);
+        }
+    }
+    if ((fds.size() != chips.size()) ||
+        (std::ranges::find(chips, invalidGpioChip) != chips.end()))
+    {
+        return -1;
+    }
+
+    for (size_t chip = 0; chip < chips.size(); chip++)
+    {
+        uint32_t requestIndex = 0;
+        for (auto& gpio : gpios)
+        {
+            if (gpio.chipId == chips[chip])
+            {
+                gpio.fd = fds[chip];
+                gpio.requestIndex = requestIndex++;
+            }
+        }
+    }
+    buttonCfg.fds.assign(fds.begin(), fds.end());
+    return 0;
 }
 
 int configGroupGpio(ButtonConfig& buttonIFConfig)
 {
     int result = 0;
+
+    if (GPIO_CHARDEV)
+    {
+        result = configGroupGpioLines(buttonIFConfig);
+        if (result < 0)
+        {
+            lg2::error("{NAME}: Error requesting gpio lines: {RESULT}", "NAME",
+                       buttonIFConfig.formFactorName, "RESULT", result);
+        }
+        return result;
+    }
+
     // iterate the list of gpios from the button interface config
     // and initialize them
     for (auto& gpioCfg : buttonIFConfig.gpios)
@@ -149,6 +929,32 @@ int configGroupGpio(ButtonConfig& buttonIFConfig)
 
 int configGpio(GpioInfo& gpioConfig, ButtonConfig& buttonIFConfig)
 {
+    if (GPIO_CHARDEV)
+    {
+        try
+        {
+            if (getGpioChipLine(gpioConfig) < 0)
+            {
+                return -1;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("{NUM} error in finding gpiochip: {ERROR}", "NUM",
+                       gpioConfig.number, "ERROR", e);
+            return -1;
+        }
+
+        GpioInfo* line = &gpioConfig;
+        return requestGpioLines(std::span(&line, 1), buttonIFConfig);
+    }
+
+    // already exported and opened by configGpios at startup
+    if (gpioConfig.fd >= 0)
+    {
+        return 0;
+    }
+
     auto gpioNum = gpioConfig.number;
     auto gpioDirection = gpioConfig.direction;
 
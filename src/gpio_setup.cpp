@@ -0,0 +1,262 @@
+#include "gpio_setup.hpp"
+
+#include "config.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+constexpr auto gpioSysfsDir = "/sys/class/gpio";
+
+// the sysfs writes of a BMC are mostly waiting on the gpio driver, a few
+// workers are enough to overlap them
+constexpr unsigned maxSetupWorkers = 4;
+
+static std::string readSysfs(const std::string& path)
+{
+    std::string value(16, '\0');
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return {};
+    }
+    auto result = ::read(fd, value.data(), value.size());
+    ::close(fd);
+
+    value.resize(std::max<ssize_t>(result, 0));
+    while (!value.empty() && (value.back() == '\n'))
+    {
+        value.pop_back();
+    }
+    return value;
+}
+
+static int writeSysfs(const std::string& path, const std::string& value)
+{
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0)
+    {
+        lg2::error("Open {PATH} error: {ERROR}", "PATH", path, "ERROR", errno);
+        return -1;
+    }
+
+    int result = 0;
+    if (::write(fd, value.c_str(), value.size()) < 0)
+    {
+        lg2::error("Error in writing {PATH}: {ERROR}", "PATH", path, "ERROR",
+                   errno);
+        result = -1;
+    }
+    ::close(fd);
+    return result;
+}
+
+/**
+ * @brief sets direction and edge of an exported gpio, only writing the
+ * attributes that differ from what the kernel already has.
+ * @return int returns 0 on success, -1 on error
+ */
+static int configExportedGpio(const GpioInfo& gpio, size_t& skipped)
+{
+    std::string path =
+        std::string(gpioSysfsDir) + "/gpio" + std::to_string(gpio.number);
+    std::string direction = readSysfs(path + "/direction");
+
+    if (gpio.direction == "out")
+    {
+        if (direction == "out")
+        {
+            skipped++;
+            return 0;
+        }
+        // keep the current level while switching to an output
+        auto value = readSysfs(path + "/value");
+        return writeSysfs(path + "/direction", value == "1" ? "high" : "low");
+    }
+
+    if ((gpio.direction == "in") || (gpio.direction == "both"))
+    {
+        if (direction == "in")
+        {
+            skipped++;
+        }
+        else if (writeSysfs(path + "/direction", "in") < 0)
+        {
+            return -1;
+        }
+    }
+
+    if (gpio.direction == "both")
+    {
+        if (readSysfs(path + "/edge") == "both")
+        {
+            skipped++;
+        }
+        else if (writeSysfs(path + "/edge", "both") < 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int configGpios(std::span<ButtonConfig> buttonConfigs)
+{
+    if (GPIO_CHARDEV)
+    {
+        return 0;
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+
+    // every line once, the same gpio may be listed by several buttons
+    std::vector<GpioInfo*> gpios;
+    std::set<uint32_t> numbers;
+    for (auto& buttonCfg : buttonConfigs)
+    {
+        for (auto& gpio : buttonCfg.gpios)
+        {
+            if ((gpio.fd < 0) && numbers.insert(gpio.number).second)
+            {
+                gpios.push_back(&gpio);
+            }
+        }
+    }
+
+    // snapshot of what is already exported, one directory read
+    std::set<uint32_t> exported;
+    try
+    {
+        for (const auto& entry : fs::directory_iterator(gpioSysfsDir))
+        {
+            std::string name = entry.path().filename();
+            if (name.starts_with("gpio") && !name.starts_with("gpiochip"))
+            {
+                exported.insert(std::stoul(name.substr(4)));
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Error reading {PATH}: {ERROR}", "PATH", gpioSysfsDir,
+                   "ERROR", e);
+    }
+    auto snapshotDone = clock::now();
+
+    // the export file takes one gpio per write, reuse a single open
+    size_t exportCount = 0;
+    int exportFd = ::open((std::string(gpioSysfsDir) + "/export").c_str(),
+                          O_WRONLY);
+    for (const auto* gpio : gpios)
+    {
+        if (exported.contains(gpio->number))
+        {
+            continue;
+        }
+
+        auto number = std::to_string(gpio->number);
+        if ((exportFd < 0) ||
+            (::write(exportFd, number.c_str(), number.size()) < 0))
+        {
+            lg2::error("{NUM} error in exporting gpio: {ERROR}", "NUM",
+                       gpio->number, "ERROR", errno);
+            continue;
+        }
+        exportCount++;
+    }
+    if (exportFd >= 0)
+    {
+        ::close(exportFd);
+    }
+    auto exportDone = clock::now();
+
+    // direction and edge are independent per gpio, set them in parallel
+    std::vector<int> results(gpios.size(), -1);
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> skippedWrites = 0;
+    auto worker = [&]() {
+        size_t skipped = 0;
+        for (size_t index = next++; index < gpios.size(); index = next++)
+        {
+            results[index] = configExportedGpio(*gpios[index], skipped);
+        }
+        skippedWrites += skipped;
+    };
+
+    {
+        unsigned workerCount = std::clamp<unsigned>(
+            std::thread::hardware_concurrency(), 1, maxSetupWorkers);
+        workerCount = std::min<size_t>(workerCount, gpios.size());
+
+        std::vector<std::jthread> workers;
+        for (unsigned count = 0; count < workerCount; count++)
+        {
+            workers.emplace_back(worker);
+        }
+    }
+    auto configDone = clock::now();
+
+    // open the value fds, the buttons listing the same gpio get their own fd
+    int failed = 0;
+    for (auto& buttonCfg : buttonConfigs)
+    {
+        for (auto& gpio : buttonCfg.gpios)
+        {
+            if (gpio.fd >= 0)
+            {
+                continue;
+            }
+
+            auto first = std::ranges::find(gpios, gpio.number,
+                                           &GpioInfo::number);
+            if ((first == gpios.end()) ||
+                (results[first - gpios.begin()] < 0))
+            {
+                failed++;
+                continue;
+            }
+
+            std::string path = std::string(gpioSysfsDir) + "/gpio" +
+                               std::to_string(gpio.number) + "/value";
+            int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+            if (fd < 0)
+            {
+                lg2::error("Open {PATH} error: {ERROR}", "PATH", path, "ERROR",
+                           errno);
+                failed++;
+                continue;
+            }
+
+            gpio.fd = fd;
+            buttonCfg.fds.push_back(fd);
+        }
+    }
+    auto openDone = clock::now();
+
+    auto us = [](auto duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count();
+    };
+    lg2::info(
+        "GPIO setup: {COUNT} gpios, {EXPORTED} exported, {SKIPPED} writes skipped, {FAILED} failed; snapshot {SNAPSHOT_US}us, export {EXPORT_US}us, configure {CONFIG_US}us, open {OPEN_US}us",
+        "COUNT", gpios.size(), "EXPORTED", exportCount, "SKIPPED",
+        skippedWrites.load(), "FAILED", failed, "SNAPSHOT_US",
+        us(snapshotDone - start), "EXPORT_US", us(exportDone - snapshotDone),
+        "CONFIG_US", us(configDone - exportDone), "OPEN_US",
+        us(openDone - configDone));
+
+    return failed;
+}
@@ -30,37 +30,49 @@ size_t HostSelector::getMappedHSConfig(size_t hsPosition)
 
 size_t HostSelector::getGpioIndex(int fd)
 {
-    for (size_t index = 0; index < gpioLineCount; index++)
+    auto& registry = LineRegistry::instance();
+    auto line = registry.find(fd);
+    if ((line == LineRegistry::invalidHandle) ||
+        (registry.getOwner(line) != this))
     {
-        if (config.gpios[index].fd == fd)
-        {
-            return index;
-        }
+        return INVALID_INDEX;
     }
-    return INVALID_INDEX;
+    return registry.getIndex(line);
 }
 
-char HostSelector::getValueFromFd(int fd)
+size_t HostSelector::readCpldPosition(int fd)
 {
-    char buf;
-    auto result = ::lseek(fd, 0, SEEK_SET);
+    std::optional<uint16_t> value;
 
-    if (result < 0)
+    // an i2c-dev register was sampled already, by CpldDevices
+    if (isI2cCpld())
     {
-        throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-            IOError();
+        value = CpldDevices::instance().getValue(*this);
+    }
+    else
+    {
+        value = config.cpld.decoder.read(fd);
     }
 
-    result = ::read(fd, &buf, sizeof(buf));
-    if (result < 0)
+    if (!value)
     {
         throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
             IOError();
     }
-    return buf;
+    // the register holds no position the decode spec knows
+    if (*value == CpldDecoder::invalidValue)
+    {
+        return INVALID_INDEX;
+    }
+    return *value;
 }
 
 void HostSelector::setInitialHostSelectorValue()
+{
+    updateHostSelectorValue(true);
+}
+
+void HostSelector::updateHostSelectorValue(bool skipSignal)
 {
     size_t hsPosMapped = 0;
 
@@ -68,19 +80,12 @@ void HostSelector::setInitialHostSelectorValue()
     {
         if (config.type == ConfigType::gpio)
         {
-            for (size_t index = 0; index < gpioLineCount; index++)
-            {
-                GpioState gpioState =
-                    (getValueFromFd(config.gpios[index].fd) == '0')
-                        ? (GpioState::deassert)
-                        : (GpioState::assert);
-                setHostSelectorValue(config.gpios[index].fd, gpioState);
-            }
+            readHostSelectorGpios();
             hsPosMapped = getMappedHSConfig(hostSelectorPosition);
         }
         else if (config.type == ConfigType::cpld)
         {
-            hsPosMapped = getValueFromFd(config.cpld.cpldMappedFd) - '0';
+            hsPosMapped = readCpldPosition(config.cpld.cpldMappedFd);
         }
     }
     catch (const std::exception& e)
@@ -89,29 +94,33 @@ void HostSelector::setInitialHostSelectorValue()
                    getFormFactorType(), "ERROR", e.what());
     }
 
-    if (config.extraJsonInfo.value("polling_mode", false))
+    if (hsPosMapped != INVALID_INDEX)
+    {
+        position(hsPosMapped, skipSignal);
+        previousPos = hsPosMapped;
+    }
+}
+
+void HostSelector::readHostSelectorGpios()
+{
+    // all the selector lines are sampled together, with gpio-chardev
+    // this is a single ioctl per line request
+    if (readGroupGpioValues(std::span(config.gpios).first(gpioLineCount),
+                            gpioValues) < 0)
     {
-        // If polling mode is enabled, set up a timer to poll the GPIO state
-        int intervalMs =
-            config.extraJsonInfo.value("polling_interval_ms", 1000);
-        auto event = Event::get_default();
-        pollTimer.emplace(
-            event, [this](Timer&) { pollGpioState(); },
-            std::chrono::milliseconds(intervalMs));
-        pollTimer->setEnabled(true);
-        lg2::info("Started polling mode: {MS}ms", "MS", intervalMs);
+        throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
+            IOError();
     }
 
-    if (hsPosMapped != INVALID_INDEX)
+    for (size_t index = 0; index < gpioLineCount; index++)
     {
-        position(hsPosMapped, true);
+        setHostSelectorValue(
+            index, toGpioState(config.gpios[index].polarity, gpioValues[index]));
     }
 }
 
-void HostSelector::setHostSelectorValue(int fd, GpioState state)
+void HostSelector::setHostSelectorValue(size_t pos, GpioState state)
 {
-    size_t pos = getGpioIndex(fd);
-
     if (pos == INVALID_INDEX)
     {
         return;
@@ -126,40 +135,63 @@ void HostSelector::setHostSelectorValue(int fd, GpioState state)
     return;
 }
 /**
- * @brief This method is called from sd-event provided callback function
- * callbackHandler if platform specific event handling is needed then a
- * derived class instance with its specific event handling logic along with
- * init() function can be created to override the default event handling
+ * @brief This method is called from the io event sources of the button,
+ * if platform specific event handling is needed then a derived class
+ * instance with its specific event handling logic along with init()
+ * function can be created to override the default event handling
  */
 
 void HostSelector::handleEvent(sd_event_source* /* es */, int fd,
                                uint32_t /* revents */)
 {
-    char buf = '0';
-    try
-    {
-        buf = getValueFromFd(fd);
-    }
-    catch (const std::exception& e)
-    {
-        lg2::error("{TYPE}: exception while reading fd : {ERROR}", "TYPE",
-                   getFormFactorType(), "ERROR", e.what());
-        return;
-    }
-
     size_t hsPosMapped = 0;
     if (config.type == ConfigType::gpio)
     {
-        // read the gpio state for the io event received
-        GpioState gpioState =
-            (buf == '0') ? (GpioState::deassert) : (GpioState::assert);
+        auto edges = readEdges(fd);
+        if (!edges)
+        {
+            return;
+        }
 
-        setHostSelectorValue(fd, gpioState);
+        if (GPIO_CHARDEV)
+        {
+            // the fd is shared by the lines of the group, resample them
+            // all at once instead of replaying the edges one by one
+            try
+            {
+                readHostSelectorGpios();
+            }
+            catch (const std::exception& e)
+            {
+                lg2::error("{TYPE}: exception while reading gpios : {ERROR}",
+                           "TYPE", getFormFactorType(), "ERROR", e.what());
+                degrade();
+                return;
+            }
+        }
+        else
+        {
+            // read the gpio state for the io event received
+            for (const auto& edge : *edges)
+            {
+                setHostSelectorValue(getGpioIndex(fd), edge.state);
+            }
+        }
         hsPosMapped = getMappedHSConfig(hostSelectorPosition);
     }
     else if (config.type == ConfigType::cpld)
     {
-        hsPosMapped = buf - '0';
+        try
+        {
+            hsPosMapped = readCpldPosition(fd);
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("{TYPE}: exception while reading fd : {ERROR}", "TYPE",
+                       getFormFactorType(), "ERROR", e.what());
+            degrade();
+            return;
+        }
     }
 
     if (hsPosMapped != INVALID_INDEX)
@@ -168,22 +200,42 @@ void HostSelector::handleEvent(sd_event_source* /* es */, int fd,
     }
 }
 
-void HostSelector::pollGpioState()
+bool HostSelector::poll()
 {
-    for (const auto& gpioInfo : config.gpios)
+    size_t currentPos = INVALID_INDEX;
+
+    if (!isFunctional())
     {
-        GpioState state = getGpioState(gpioInfo.fd, gpioInfo.polarity);
-        setHostSelectorValue(gpioInfo.fd, state);
-        lg2::debug("GPIO {NUM} state is {STATE}", "NUM", gpioInfo.number,
-                   "STATE", state);
+        return false;
     }
 
-    size_t currentPos = getMappedHSConfig(hostSelectorPosition);
+    try
+    {
+        if (config.type == ConfigType::gpio)
+        {
+            readHostSelectorGpios();
+            currentPos = getMappedHSConfig(hostSelectorPosition);
+        }
+        else if (config.type == ConfigType::cpld)
+        {
+            currentPos = readCpldPosition(config.cpld.cpldMappedFd);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("{TYPE}: exception while polling : {ERROR}", "TYPE",
+                   getFormFactorType(), "ERROR", e.what());
+        degrade();
+        return false;
+    }
 
-    if (currentPos != INVALID_INDEX && currentPos != previousPos)
+    if (currentPos == INVALID_INDEX || currentPos == previousPos)
     {
-        position(currentPos);
-        previousPos = currentPos;
-        lg2::info("Host selector position updated to {POS}", "POS", currentPos);
+        return false;
     }
+
+    position(currentPos);
+    previousPos = currentPos;
+    lg2::info("Host selector position updated to {POS}", "POS", currentPos);
+    return true;
 }
@@ -27,37 +27,25 @@ void IDButton::simPress()
 void IDButton::handleEvent(sd_event_source* /* es */, int fd,
                            uint32_t /* revents */)
 {
-    int n = -1;
-    char buf = '0';
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
+    auto edges = readEdges(fd);
+    if (!edges)
     {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            (getFormFactorType() + " : lseek error!").c_str());
         return;
     }
 
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
-    {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            (getFormFactorType() + " : read error!").c_str());
-        return;
-    }
-
-    if (buf == '0')
-    {
-        phosphor::logging::log<phosphor::logging::level::DEBUG>(
-            (getFormFactorType() + " : pressed").c_str());
-        // emit pressed signal
-        pressed();
-    }
-    else
+    for (const auto& edge : *edges)
     {
-        phosphor::logging::log<phosphor::logging::level::DEBUG>(
-            (getFormFactorType() + " : released").c_str());
-        // released
-        released();
+        if (edge.state == GpioState::assert)
+        {
+            lg2::debug("{TYPE}: pressed", "TYPE", getFormFactorType());
+            // emit pressed signal
+            pressed();
+        }
+        else
+        {
+            lg2::debug("{TYPE}: released", "TYPE", getFormFactorType());
+            // released
+            released();
+        }
     }
 }
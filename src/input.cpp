@@ -0,0 +1,338 @@
+#include "input.hpp"
+
+#include "button_config.hpp"
+#include "button_interface.hpp"
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+constexpr auto inputSysfsDir = "/sys/class/input";
+
+// input events read from a device by one read()
+constexpr size_t inputEventBatch = 64;
+
+using KeyBits = std::array<uint8_t, (KEY_MAX / 8) + 1>;
+
+static bool testKey(const KeyBits& bits, uint16_t code)
+{
+    return (bits[code / 8] >> (code % 8)) & 1;
+}
+
+int configInput(ButtonConfig& buttonCfg)
+{
+    auto& input = buttonCfg.input;
+
+    if (input.device.starts_with('/'))
+    {
+        input.path = input.device;
+        return 0;
+    }
+
+    // the eventN numbers depend on probe order, look the device up by name
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(inputSysfsDir, ec))
+    {
+        std::string event = entry.path().filename();
+        if (!event.starts_with("event"))
+        {
+            continue;
+        }
+
+        std::ifstream nameFile(entry.path() / "device" / "name");
+        std::string name;
+        std::getline(nameFile, name);
+        if (name == input.device)
+        {
+            input.path = "/dev/input/" + event;
+            return 0;
+        }
+    }
+
+    lg2::error("{NAME}: input device {DEVICE} not found", "NAME",
+               buttonCfg.formFactorName, "DEVICE", input.device);
+    return -1;
+}
+
+int InputDevices::add(sd_event* event, InputInfo& input, int64_t priority,
+                      ButtonIface& owner)
+{
+    auto [entry, added] = devices.try_emplace(input.path);
+    auto& device = entry->second;
+
+    if (added)
+    {
+        device.path = input.path;
+        device.priority = priority;
+        device.fd = ::open(input.path.c_str(),
+                           O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (device.fd < 0)
+        {
+            int ret = -errno;
+            lg2::error("Open {PATH} error: {ERROR}", "PATH", input.path,
+                       "ERROR", -ret);
+            devices.erase(entry);
+            return ret;
+        }
+
+        // timestamps on the clock of std::chrono::steady_clock, so the
+        // press durations are not affected by a change of the wall clock
+        int clock = CLOCK_MONOTONIC;
+        if (::ioctl(device.fd, EVIOCSCLOCKID, &clock) < 0)
+        {
+            lg2::error("{PATH}: failed to set the event clock: {ERROR}",
+                       "PATH", input.path, "ERROR", errno);
+        }
+
+        int ret = sd_event_add_io(event, &device.source, device.fd, EPOLLIN,
+                                  dispatch, &device);
+        if (ret >= 0)
+        {
+            ret = sd_event_source_set_priority(device.source, priority);
+        }
+        if (ret < 0)
+        {
+            lg2::error("{PATH}: failed to add to event loop: {ERROR}", "PATH",
+                       input.path, "ERROR", ret);
+            close(device);
+            return ret;
+        }
+    }
+
+    KeyBits supported{};
+    KeyBits pressed{};
+    if ((::ioctl(device.fd, EVIOCGBIT(EV_KEY, supported.size()),
+                 supported.data()) < 0) ||
+        (::ioctl(device.fd, EVIOCGKEY(pressed.size()), pressed.data()) < 0) ||
+        !testKey(supported, input.keyCode))
+    {
+        lg2::error("{PATH}: key {CODE} not reported", "PATH", input.path,
+                   "CODE", input.keyCode);
+        if (device.subscribers.empty())
+        {
+            close(device);
+        }
+        return -ENOENT;
+    }
+
+    // the device is read at the most important priority of its buttons
+    if (priority < device.priority)
+    {
+        device.priority = priority;
+        sd_event_source_set_priority(device.source, priority);
+    }
+
+    device.subscribers.push_back(
+        {input.keyCode, &owner,
+         testKey(pressed, input.keyCode) ? GpioState::assert
+                                         : GpioState::deassert});
+    input.fd = device.fd;
+    return 0;
+}
+
+void InputDevices::remove(ButtonIface& owner)
+{
+    for (auto entry = devices.begin(); entry != devices.end();)
+    {
+        auto& device = (entry++)->second;
+        std::erase_if(device.subscribers, [&owner](const auto& subscriber) {
+            return subscriber.owner == &owner;
+        });
+        if (device.subscribers.empty())
+        {
+            close(device);
+        }
+    }
+}
+
+void InputDevices::setEnabled(ButtonIface& owner, bool enabled)
+{
+    for (auto& [path, device] : devices)
+    {
+        bool wasEnabled = std::ranges::any_of(device.subscribers,
+                                              &Subscriber::enabled);
+        for (auto& subscriber : device.subscribers)
+        {
+            if (subscriber.owner == &owner)
+            {
+                subscriber.enabled = enabled;
+            }
+        }
+
+        bool isEnabled = std::ranges::any_of(device.subscribers,
+                                             &Subscriber::enabled);
+        if (isEnabled && !wasEnabled)
+        {
+            // what was queued while paused is stale
+            std::array<input_event, inputEventBatch> events;
+            while (::read(device.fd, events.data(), sizeof(events)) > 0)
+            {}
+            device.dropped = false;
+            readKeys(device, nullptr);
+        }
+        else if (enabled)
+        {
+            // the device kept being read, only the key of owner is stale
+            readKeys(device, &owner);
+        }
+
+        if (isEnabled != wasEnabled)
+        {
+            sd_event_source_set_enabled(device.source, isEnabled ? SD_EVENT_ON
+                                                                 : SD_EVENT_OFF);
+        }
+    }
+}
+
+void InputDevices::readKeys(Device& device, const ButtonIface* owner)
+{
+    KeyBits pressed{};
+    if (::ioctl(device.fd, EVIOCGKEY(pressed.size()), pressed.data()) < 0)
+    {
+        lg2::error("{PATH}: failed to read the key states: {ERROR}", "PATH",
+                   device.path, "ERROR", errno);
+        return;
+    }
+    for (auto& subscriber : device.subscribers)
+    {
+        if ((owner == nullptr) || (subscriber.owner == owner))
+        {
+            subscriber.state = testKey(pressed, subscriber.keyCode)
+                                   ? GpioState::assert
+                                   : GpioState::deassert;
+        }
+    }
+}
+
+void InputDevices::close(Device& device)
+{
+    sd_event_source_disable_unref(device.source);
+    if (device.fd >= 0)
+    {
+        ::close(device.fd);
+    }
+    devices.erase(device.path);
+}
+
+int InputDevices::dispatch(sd_event_source* /* es */, int /* fd */,
+                           uint32_t /* revents */, void* userdata)
+{
+    instance().read(*static_cast<Device*>(userdata));
+    return 0;
+}
+
+void InputDevices::read(Device& device)
+{
+    std::array<input_event, inputEventBatch> events;
+    auto size = ::read(device.fd, events.data(), sizeof(events));
+    if (size < 0)
+    {
+        if ((errno == EAGAIN) || (errno == EINTR))
+        {
+            return;
+        }
+
+        // e.g. the device went away, its buttons recover once it is back
+        lg2::error("{PATH}: read error: {ERROR}", "PATH", device.path,
+                   "ERROR", errno);
+        std::vector<ButtonIface*> owners;
+        for (const auto& subscriber : device.subscribers)
+        {
+            owners.push_back(subscriber.owner);
+        }
+        for (auto* owner : owners)
+        {
+            owner->degrade();
+        }
+        return;
+    }
+
+    pending.resize(device.subscribers.size());
+    for (auto& edges : pending)
+    {
+        edges.clear();
+    }
+
+    auto count = static_cast<size_t>(size) / sizeof(input_event);
+    for (const auto& event : std::span(events).first(count))
+    {
+        if (event.type == EV_SYN)
+        {
+            if (event.code == SYN_DROPPED)
+            {
+                device.dropped = true;
+            }
+            else if ((event.code == SYN_REPORT) && device.dropped)
+            {
+                device.dropped = false;
+                resync(device, std::chrono::steady_clock::now());
+            }
+            continue;
+        }
+
+        // autorepeat (value 2) is not an edge
+        if (device.dropped || (event.type != EV_KEY) || (event.value > 1))
+        {
+            continue;
+        }
+
+        auto state = event.value ? GpioState::assert : GpioState::deassert;
+        auto time = std::chrono::steady_clock::time_point(
+            std::chrono::seconds(event.input_event_sec) +
+            std::chrono::microseconds(event.input_event_usec));
+        for (size_t index = 0; index < device.subscribers.size(); index++)
+        {
+            auto& subscriber = device.subscribers[index];
+            if (subscriber.enabled && (subscriber.keyCode == event.code) &&
+                (subscriber.state != state))
+            {
+                subscriber.state = state;
+                pending[index].push_back({state, time});
+            }
+        }
+    }
+
+    // the handlers don't add or remove buttons, the subscribers are stable
+    int fd = device.fd;
+    for (size_t index = 0; index < device.subscribers.size(); index++)
+    {
+        if (!pending[index].empty())
+        {
+            device.subscribers[index].owner->injectEdges(fd, pending[index]);
+        }
+    }
+}
+
+void InputDevices::resync(Device& device,
+                          std::chrono::steady_clock::time_point now)
+{
+    KeyBits pressed{};
+    if (::ioctl(device.fd, EVIOCGKEY(pressed.size()), pressed.data()) < 0)
+    {
+        lg2::error("{PATH}: failed to read the key states: {ERROR}", "PATH",
+                   device.path, "ERROR", errno);
+        return;
+    }
+
+    for (size_t index = 0; index < device.subscribers.size(); index++)
+    {
+        auto& subscriber = device.subscribers[index];
+        auto state = testKey(pressed, subscriber.keyCode)
+                         ? GpioState::assert
+                         : GpioState::deassert;
+        if (subscriber.enabled && (subscriber.state != state))
+        {
+            subscriber.state = state;
+            pending[index].push_back({state, now});
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include "line_registry.hpp"
+
+#include <algorithm>
+
+LineRegistry::Handle LineRegistry::add(int fd, Owner owner, uint32_t index)
+{
+    if (fd < 0)
+    {
+        return invalidHandle;
+    }
+
+    Handle handle = 0;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        fds[handle] = fd;
+        owners[handle] = owner;
+        indexes[handle] = index;
+    }
+    else
+    {
+        handle = fds.size();
+        fds.push_back(fd);
+        owners.push_back(owner);
+        indexes.push_back(index);
+    }
+
+    // fds are small and dense, they index the lookup table directly
+    if (static_cast<size_t>(fd) >= byFd.size())
+    {
+        byFd.resize(fd + 1, invalidHandle);
+    }
+    if (byFd[fd] == invalidHandle)
+    {
+        byFd[fd] = handle;
+    }
+    return handle;
+}
+
+void LineRegistry::remove(Handle handle)
+{
+    if ((handle >= fds.size()) || (fds[handle] < 0))
+    {
+        return;
+    }
+
+    int fd = fds[handle];
+    fds[handle] = -1;
+    owners[handle] = nullptr;
+    freeHandles.push_back(handle);
+
+    // the fd moves on to another of its lines, if any, removals are rare
+    // enough to scan for it
+    if (byFd[fd] == handle)
+    {
+        auto next = std::ranges::find(fds, fd);
+        byFd[fd] = (next != fds.end())
+                       ? static_cast<Handle>(next - fds.begin())
+                       : invalidHandle;
+    }
+}
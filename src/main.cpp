@@ -16,19 +16,133 @@
 
 #include "button_config.hpp"
 #include "button_factory.hpp"
+#include "bus_source.hpp"
+#include "config_watcher.hpp"
+#include "fd_store.hpp"
+#include "gpio_setup.hpp"
+#include "startup_timing.hpp"
 
-#include <nlohmann/json.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 
-#include <fstream>
+/**
+ * @brief creates the buttons of buttonConfigs, which are consumed. The gpios
+ * of all the buttons are configured together before the objects are created.
+ */
+static void createButtons(
+    sdbusplus::bus_t& bus, EventPtr& event,
+    std::vector<ButtonConfig>& buttonConfigs,
+    std::vector<std::unique_ptr<ButtonIface>>& buttonInterfaces)
+{
+    auto& timing = StartupTiming::instance();
+    std::vector<ButtonConfig> gpioButtonConfigs;
 
-int main(void)
+    auto create = [&](ButtonConfig& buttonCfg) {
+        auto created = StartupTiming::Clock::now();
+        auto tempButtonIf = ButtonFactory::instance().createInstance(
+            buttonCfg.formFactorName, bus, event, buttonCfg);
+        if (tempButtonIf)
+        {
+            timing.button(buttonCfg.formFactorName, created);
+            buttonInterfaces.emplace_back(std::move(tempButtonIf));
+        }
+    };
+
+    for (auto& buttonCfg : buttonConfigs)
+    {
+        // a restarted daemon takes back the lines it had configured
+        FdStore::instance().adopt(buttonCfg);
+        if (buttonCfg.type == ConfigType::gpio)
+        {
+            gpioButtonConfigs.emplace_back(std::move(buttonCfg));
+            continue;
+        }
+        create(buttonCfg);
+    }
+    buttonConfigs.clear();
+    timing.phase("cpld and input buttons");
+
+    // the lines of changed definitions are requested again below
+    FdStore::instance().releaseUnused();
+    configGpios(gpioButtonConfigs);
+    timing.phase("gpio configuration");
+
+    for (auto& buttonCfg : gpioButtonConfigs)
+    {
+        create(buttonCfg);
+    }
+    timing.phase("gpio buttons");
+
+    // the objects are announced in one burst once every line is configured,
+    // with a single InterfacesAdded per path, so no client sees a partial
+    // set of buttons
+    for (auto& button : buttonInterfaces)
+    {
+        button->announce();
+    }
+    timing.phase("object announcement");
+}
+
+#if !PLATFORM_TABLES
+/**
+ * @brief applies a changed gpio_defs.json to the running buttons. A button
+ * whose definition didn't change is left untouched, the buttons of removed
+ * or changed definitions are taken down, freeing their lines and objects,
+ * then the buttons of new or changed definitions are created. A file that
+ * can't be loaded changes nothing.
+ */
+static void reloadButtons(
+    sdbusplus::bus_t& bus, EventPtr& event,
+    std::vector<std::unique_ptr<ButtonIface>>& buttonInterfaces)
 {
-    nlohmann::json gpioDefs;
-    nlohmann::json cpldDefs;
+    std::vector<ButtonConfig> buttonConfigs;
+    try
+    {
+        buttonConfigs = loadButtonConfigs(gpioDefFile);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Keeping the buttons, {FILE} failed to load: {ERROR}",
+                   "FILE", gpioDefFile, "ERROR", e);
+        return;
+    }
+
+    // the key of a config changes with its definition
+    std::vector<std::unique_ptr<ButtonIface>> kept;
+    size_t removed = 0;
+    for (auto& button : buttonInterfaces)
+    {
+        auto same = std::ranges::find(buttonConfigs,
+                                      button->getDefinitionKey(),
+                                      &ButtonConfig::fdStoreKey);
+        if (same != buttonConfigs.end())
+        {
+            buttonConfigs.erase(same);
+            kept.emplace_back(std::move(button));
+            continue;
+        }
 
+        lg2::info("{TYPE}: definition removed or changed", "TYPE",
+                  button->getFormFactorType());
+        button->retire();
+        button.reset();
+        removed++;
+    }
+    buttonInterfaces = std::move(kept);
+
+    size_t added = buttonConfigs.size();
+    createButtons(bus, event, buttonConfigs, buttonInterfaces);
+    lg2::info("Reloaded {FILE}: {KEPT} buttons kept, {REMOVED} removed, "
+              "{ADDED} added",
+              "FILE", gpioDefFile, "KEPT", buttonInterfaces.size() - added,
+              "REMOVED", removed, "ADDED", added);
+}
+#endif
+
+int main(void)
+{
     int ret = 0;
+    auto& timing = StartupTiming::instance();
 
     lg2::info("Start Phosphor buttons service...");
 
@@ -45,112 +159,43 @@ int main(void)
     sdbusplus::bus_t bus = sdbusplus::bus::new_default();
     sdbusplus::server::manager_t objManager{
         bus, "/xyz/openbmc_project/Chassis/Buttons"};
+    timing.phase("event loop and bus");
 
-    bus.request_name("xyz.openbmc_project.Chassis.Buttons");
     std::vector<std::unique_ptr<ButtonIface>> buttonInterfaces;
 
-    std::ifstream gpios{gpioDefFile};
-    auto configDefJson = nlohmann::json::parse(gpios, nullptr, true);
-    gpioDefs = configDefJson["gpio_definitions"];
-    cpldDefs = configDefJson["cpld_definitions"];
-
-    // load cpld config from gpio defs json file and create button interface
-    for (const auto& cpldConfig : cpldDefs)
-    {
-        std::string formFactorName = cpldConfig["name"];
-
-        ButtonConfig buttonCfg;
-        buttonCfg.type = ConfigType::cpld;
-        buttonCfg.formFactorName = formFactorName;
-        buttonCfg.extraJsonInfo = cpldConfig;
-
-        CpldInfo cpldCfg;
-        cpldCfg.registerName = cpldConfig["register_name"];
+#if PLATFORM_TABLES
+    // the definitions were compiled into the daemon, gpio_defs.json is not
+    // read
+    auto buttonConfigs = loadPlatformButtonConfigs();
+#else
+    auto buttonConfigs = loadButtonConfigs(gpioDefFile);
+#endif
+    timing.phase("definitions");
 
-        cpldCfg.i2cAddress = cpldConfig["i2c_address"].get<int>();
-        cpldCfg.i2cBus = cpldConfig["i2c_bus"].get<int>();
-        buttonCfg.cpld = cpldCfg;
-
-        auto tempButtonIf = ButtonFactory::instance().createInstance(
-            formFactorName, bus, eventP, buttonCfg);
-        if (tempButtonIf)
-        {
-            buttonInterfaces.emplace_back(std::move(tempButtonIf));
-        }
-    }
-
-    // load gpio config from gpio defs json file and create button interface
+    // load config from gpio defs json file and create button interface
     // objects based on the button form factor type
+    createButtons(bus, eventP, buttonConfigs, buttonInterfaces);
 
-    for (const auto& gpioConfig : gpioDefs)
-    {
-        std::string formFactorName = gpioConfig["name"];
-        ButtonConfig buttonCfg;
-        buttonCfg.formFactorName = formFactorName;
-        buttonCfg.extraJsonInfo = gpioConfig;
-        buttonCfg.type = ConfigType::gpio;
-
-        /* The following code checks if the gpio config read
-        from json file is single gpio config or group gpio config,
-        based on that further data is processed. */
-        lg2::debug("Found button config : {FORM_FACTOR_NAME}",
-                   "FORM_FACTOR_NAME", buttonCfg.formFactorName);
-        if (gpioConfig.contains("group_gpio_config"))
-        {
-            const auto& groupGpio = gpioConfig["group_gpio_config"];
-
-            for (const auto& config : groupGpio)
-            {
-                GpioInfo gpioCfg;
-                if (config.contains("pin"))
-                {
-                    // When "pin" key is used, parse as alphanumeric
-                    gpioCfg.number = getGpioNum(config.at("pin"));
-                }
-                else
-                {
-                    // Without "pin", "num" is assumed and parsed as an integer
-                    gpioCfg.number = config.at("num").get<uint32_t>();
-                }
-                gpioCfg.direction = config["direction"];
-                gpioCfg.name = config["name"];
-                gpioCfg.polarity = (config["polarity"] == "active_high")
-                                       ? GpioPolarity::activeHigh
-                                       : GpioPolarity::activeLow;
-                buttonCfg.gpios.push_back(gpioCfg);
-            }
-        }
-        else
-        {
-            GpioInfo gpioCfg;
-            if (gpioConfig.contains("pin"))
-            {
-                // When "pin" key is used, parse as alphanumeric
-                gpioCfg.number = getGpioNum(gpioConfig.at("pin"));
-            }
-            else
-            {
-                // Without "pin", "num" is assumed and parsed as an integer
-                gpioCfg.number = gpioConfig.at("num").get<uint32_t>();
-            }
-            gpioCfg.direction = gpioConfig["direction"];
-            buttonCfg.gpios.push_back(gpioCfg);
-        }
-        auto tempButtonIf = ButtonFactory::instance().createInstance(
-            formFactorName, bus, eventP, buttonCfg);
-        /* There are additional gpio configs present in some platforms
-         that are not supported in phosphor-buttons.
-        But they may be used by other applications. so skipping such configs
-        if present in gpio_defs.json file*/
-        if (tempButtonIf)
-        {
-            buttonInterfaces.emplace_back(std::move(tempButtonIf));
-        }
-    }
+    // the name is claimed once every object exists, so a client finding the
+    // service finds all of its buttons
+    bus.request_name("xyz.openbmc_project.Chassis.Buttons");
+    timing.phase("bus name");
+
+#if !PLATFORM_TABLES
+    // a changed definition is applied to its button only, the others keep
+    // running
+    ConfigWatcher configWatcher(eventP.get(), gpioDefFile, [&]() {
+        reloadButtons(bus, eventP, buttonInterfaces);
+    });
+#endif
 
     try
     {
-        bus.attach_event(eventP.get(), SD_EVENT_PRIORITY_NORMAL);
+        // a high priority edge never waits behind a burst of messages, and
+        // the bus yields to the other inputs after a burst
+        BusSource busSource(eventP.get(), bus.get(), busEventPriority);
+        // every button is armed and on D-Bus
+        timing.ready("buttons");
         ret = sd_event_loop(eventP.get());
         if (ret < 0)
         {
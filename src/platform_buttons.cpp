@@ -0,0 +1,100 @@
+#include "button_config.hpp"
+#include "button_factory.hpp"
+#include "fd_store.hpp"
+#include "platform_buttons.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+/**
+ * @brief config of a button of the platform tables, the same one
+ * makeButtonConfig() builds from its json definition
+ * @return std::nullopt for a definition the daemon doesn't serve
+ */
+static std::optional<ButtonConfig> makeButtonConfig(
+    const platform::Button& button)
+{
+    std::string formFactorName{button.name};
+    if (!ButtonFactory::instance().isRegistered(formFactorName))
+    {
+        return std::nullopt;
+    }
+
+    ButtonConfig buttonCfg;
+    buttonCfg.type = button.type;
+    buttonCfg.formFactorName = formFactorName;
+    buttonCfg.debounce = std::chrono::milliseconds(button.debounceMs);
+    buttonCfg.priority = getEventPriority(formFactorName, button.priority);
+    buttonCfg.polling = button.polling;
+    buttonCfg.gate.presenceObject = button.presenceObject;
+    buttonCfg.gate.presenceDefault = button.presenceDefault;
+    buttonCfg.gate.powerState = button.powerState;
+    buttonCfg.gate.powerStateObject = button.powerStateObject;
+
+    for (const auto& [key, position] : button.hostSelectorMap)
+    {
+        buttonCfg.hostSelector.positionMap.emplace(key, position);
+    }
+    buttonCfg.hostSelector.maxPosition = button.maxPosition;
+    buttonCfg.serialUartMux.muxMap.insert(button.serialUartMuxMap.begin(),
+                                          button.serialUartMuxMap.end());
+
+    if (button.type == ConfigType::cpld)
+    {
+        buttonCfg.cpld.registerName = button.registerName;
+        buttonCfg.cpld.registerOffset = button.registerOffset;
+        buttonCfg.cpld.i2cAddress = button.i2cAddress;
+        buttonCfg.cpld.i2cBus = button.i2cBus;
+        buttonCfg.cpld.decoder = *button.decoder;
+    }
+    else if (button.type == ConfigType::input)
+    {
+        auto keyCode = getKeyCode(formFactorName, button.keyCode);
+        if (!keyCode)
+        {
+            return std::nullopt;
+        }
+        buttonCfg.input.device =
+            button.device.empty() ? "gpio-keys" : button.device;
+        buttonCfg.input.keyCode = *keyCode;
+        return buttonCfg;
+    }
+    else
+    {
+        // the line names and chip labels are only known at run time
+        bool resolved = true;
+        for (const auto& gpio : button.gpios)
+        {
+            GpioInfo gpioCfg;
+            resolved = resolveGpio(gpioCfg, gpio.spec) && resolved;
+            gpioCfg.name = gpio.name;
+            gpioCfg.direction = gpio.direction;
+            gpioCfg.polarity = gpio.polarity;
+            buttonCfg.gpios.push_back(gpioCfg);
+        }
+        if (!resolved)
+        {
+            lg2::error("{NAME}: gpio not found, skipping", "NAME",
+                       formFactorName);
+            return std::nullopt;
+        }
+    }
+
+    // a restarted daemon takes back the lines it had configured
+    buttonCfg.fdStoreKey = FdStore::getKey(formFactorName, button.id);
+    return buttonCfg;
+}
+
+std::vector<ButtonConfig> loadPlatformButtonConfigs()
+{
+    std::vector<ButtonConfig> buttonConfigs;
+    for (const auto& button : platform::buttons)
+    {
+        if (auto buttonCfg = makeButtonConfig(button))
+        {
+            buttonConfigs.emplace_back(std::move(*buttonCfg));
+        }
+    }
+    lg2::info("Loaded {COUNT} built-in button definitions", "COUNT",
+              buttonConfigs.size());
+    return buttonConfigs;
+}
@@ -0,0 +1,111 @@
+#include "poll_scheduler.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <optional>
+
+// clients due this close to a tick are polled with it
+constexpr auto pollSlack = std::chrono::milliseconds(50);
+
+size_t PollScheduler::add(std::chrono::milliseconds minInterval,
+                          std::chrono::milliseconds maxInterval, Poll poll)
+{
+    minInterval = std::max(minInterval, std::chrono::milliseconds(1));
+    maxInterval = std::max(maxInterval, minInterval);
+
+    size_t id = nextId++;
+    clients.push_back({id, std::move(poll), minInterval, maxInterval,
+                       minInterval,
+                       std::chrono::steady_clock::now() + minInterval});
+    schedule();
+
+    lg2::info("Started polling, {MIN_MS}ms up to {MAX_MS}ms", "MIN_MS",
+              minInterval.count(), "MAX_MS", maxInterval.count());
+    return id;
+}
+
+void PollScheduler::remove(size_t id)
+{
+    // a poll can remove its own client, e.g. a shared device whose buttons
+    // all degraded, it is dropped once the tick is done
+    if (ticking)
+    {
+        auto client = std::ranges::find(clients, id, &Client::id);
+        if (client != clients.end())
+        {
+            client->removed = true;
+        }
+        return;
+    }
+
+    std::erase_if(clients,
+                  [id](const Client& client) { return client.id == id; });
+    schedule();
+}
+
+void PollScheduler::setEnabled(size_t id, bool enabled)
+{
+    auto client = std::ranges::find(clients, id, &Client::id);
+    if ((client == clients.end()) || (client->enabled == enabled))
+    {
+        return;
+    }
+
+    client->enabled = enabled;
+    client->interval = client->minInterval;
+    client->due = std::chrono::steady_clock::now() + client->interval;
+    schedule();
+}
+
+void PollScheduler::tick()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    ticking = true;
+    for (auto& client : clients)
+    {
+        if (client.removed || !client.enabled ||
+            (client.due > now + pollSlack))
+        {
+            continue;
+        }
+
+        // back off while stable, come back to the fast rate on a change
+        if (client.poll())
+        {
+            client.interval = client.minInterval;
+        }
+        else
+        {
+            client.interval = std::min(client.interval * 2, client.maxInterval);
+        }
+        client.due = now + client.interval;
+    }
+    ticking = false;
+    std::erase_if(clients, [](const Client& client) { return client.removed; });
+
+    schedule();
+}
+
+void PollScheduler::schedule()
+{
+    std::optional<std::chrono::steady_clock::time_point> due;
+    for (const auto& client : clients)
+    {
+        if (client.enabled)
+        {
+            due = std::min(due.value_or(client.due), client.due);
+        }
+    }
+    if (!due)
+    {
+        timer.setEnabled(false);
+        return;
+    }
+
+    auto remaining = std::max(*due - std::chrono::steady_clock::now(),
+                              std::chrono::steady_clock::duration::zero());
+    timer.restartOnce(
+        std::chrono::ceil<TimerWheel::Duration>(remaining));
+}
@@ -16,11 +16,8 @@
 
 #include "power_button.hpp"
 
-#include "button_handler.hpp"
-
-// add the button iface class to registry
-static ButtonIFRegister<PowerButton> multiButtonRegister(
-    phosphor::button::numberOfChassis());
+// add the button iface class to registry, for any number of slots
+static ButtonIFRegister<PowerButton> multiButtonRegister(withIndexedNames);
 
 void PowerButton::simPress()
 {
@@ -32,9 +29,10 @@ void PowerButton::simLongPress()
     pressedLong();
 }
 
-void PowerButton::updatePressedTime()
+void PowerButton::updatePressedTime(
+    std::chrono::steady_clock::time_point time)
 {
-    pressedTime = std::chrono::steady_clock::now();
+    pressedTime = time;
 }
 
 auto PowerButton::getPressTime() const
@@ -45,44 +43,34 @@ auto PowerButton::getPressTime() const
 void PowerButton::handleEvent(sd_event_source* /* es */, int fd,
                               uint32_t /* revents */)
 {
-    int n = -1;
-    char buf = '0';
-
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
+    auto edges = readEdges(fd);
+    if (!edges)
     {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            "POWER_BUTTON: lseek error!");
         return;
     }
 
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
+    // with gpio-chardev the edge times come from the kernel, so the press
+    // duration doesn't depend on when the event loop got to run
+    for (const auto& edge : *edges)
     {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            "POWER_BUTTON: read error!");
-        return;
-    }
+        if (edge.state == GpioState::assert)
+        {
+            phosphor::logging::log<phosphor::logging::level::DEBUG>(
+                "POWER_BUTTON: pressed");
 
-    if (buf == '0')
-    {
-        phosphor::logging::log<phosphor::logging::level::DEBUG>(
-            "POWER_BUTTON: pressed");
-
-        updatePressedTime();
-        // emit pressed signal
-        pressed();
-    }
-    else
-    {
-        phosphor::logging::log<phosphor::logging::level::DEBUG>(
-            "POWER_BUTTON: released");
+            updatePressedTime(edge.time);
+            // emit pressed signal
+            pressed();
+        }
+        else
+        {
+            phosphor::logging::log<phosphor::logging::level::DEBUG>(
+                "POWER_BUTTON: released");
 
-        auto now = std::chrono::steady_clock::now();
-        auto d = std::chrono::duration_cast<std::chrono::microseconds>(
-            now - getPressTime());
-        // released
-        released(d.count());
+            auto d = std::chrono::duration_cast<std::chrono::microseconds>(
+                edge.time - getPressTime());
+            // released
+            released(d.count());
+        }
     }
 }
@@ -40,9 +40,14 @@ void SerialUartMux::init()
 // check the debug card present pin
 bool SerialUartMux::isOCPDebugCardPresent()
 {
-    auto gpioState =
-        getGpioState(debugCardPresentGpio.fd, debugCardPresentGpio.polarity);
-    return (gpioState == GpioState::assert);
+    // looked up on use, the fd changes when the lines are recovered
+    auto gpio = std::ranges::find(config.gpios, DEBUG_CARD_PRESENT_GPIO,
+                                  &GpioInfo::name);
+    if (gpio == config.gpios.end())
+    {
+        return false;
+    }
+    return (getGpioState(*gpio) == GpioState::assert);
 }
 // set the serial uart MUX to select the console w.r.t host selector position
 void SerialUartMux::configSerialConsoleMux(size_t position)
@@ -61,7 +66,7 @@ void SerialUartMux::configSerialConsoleMux(size_t position)
     for (size_t uartMuxSel = 0; uartMuxSel < gpioLineCount; uartMuxSel++)
     {
         auto gpioState = GpioState::invalid;
-        GpioInfo gpioConfig = config.gpios[uartMuxSel];
+        const GpioInfo& gpioConfig = config.gpios[uartMuxSel];
 
         if (gpioConfig.name == SERIAL_UART_RX_GPIO)
         {
@@ -74,8 +79,13 @@ void SerialUartMux::configSerialConsoleMux(size_t position)
                             ? GpioState::assert
                             : GpioState::deassert;
         }
-        setGpioState(gpioConfig.fd, gpioConfig.polarity, gpioState);
+        gpioStates[uartMuxSel] = gpioState;
     }
+
+    // the mux select lines change together, with gpio-chardev in a single
+    // ioctl per line request
+    setGroupGpioState(std::span(config.gpios).first(gpioLineCount),
+                      gpioStates);
 }
 
 void SerialUartMux::hostSelectorPositionChanged(sdbusplus::message_t& msg)
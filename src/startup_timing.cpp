@@ -0,0 +1,117 @@
+#include "startup_timing.hpp"
+
+#include "config.hpp"
+
+#include <systemd/sd-daemon.h>
+
+#include <nlohmann/json.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+StartupTiming::StartupTiming() : start(Clock::now()), phaseStart(start) {}
+
+void StartupTiming::phase(std::string_view name)
+{
+    if (isReady)
+    {
+        return;
+    }
+    auto now = Clock::now();
+    phases.emplace_back(std::string(name), phaseStart, now - phaseStart);
+    phaseStart = now;
+}
+
+void StartupTiming::button(std::string_view name, Clock::time_point created)
+{
+    if (isReady)
+    {
+        return;
+    }
+    buttons.emplace_back(std::string(name), created, Clock::now() - created);
+}
+
+void StartupTiming::ready(std::string_view daemon)
+{
+    if (isReady)
+    {
+        return;
+    }
+    isReady = true;
+
+    for (const auto& entry : phases)
+    {
+        lg2::info("Startup phase {PHASE}: {DURATION_US}us", "PHASE",
+                  entry.name, "DURATION_US",
+                  duration_cast<microseconds>(entry.duration).count());
+    }
+    lg2::info("{DAEMON} ready in {DURATION_US}us, {COUNT} buttons", "DAEMON",
+              daemon, "DURATION_US",
+              duration_cast<microseconds>(Clock::now() - start).count(),
+              "COUNT", buttons.size());
+
+    dump(std::string(STARTUP_REPORT_DIR) + "/" + std::string(daemon) +
+             "-startup.json",
+         daemon);
+
+    // the buttons are armed, a Type=notify unit is started now
+    sd_notify(0, "READY=1");
+}
+
+void StartupTiming::dump(const std::string& path,
+                         std::string_view daemon) const
+{
+    auto toJson = [](const std::vector<Entry>& entries) {
+        auto list = nlohmann::json::array();
+        for (const auto& entry : entries)
+        {
+            list.push_back(
+                {{"name", entry.name},
+                 {"start_us", duration_cast<microseconds>(
+                                  entry.start.time_since_epoch())
+                                  .count()},
+                 {"duration_us",
+                  duration_cast<microseconds>(entry.duration).count()}});
+        }
+        return list;
+    };
+
+    nlohmann::json report{
+        {"daemon", daemon},
+        {"start_us",
+         duration_cast<microseconds>(start.time_since_epoch()).count()},
+        {"ready_us", duration_cast<microseconds>(
+                         Clock::now().time_since_epoch())
+                         .count()},
+        {"phases", toJson(phases)},
+        {"buttons", toJson(buttons)}};
+
+    try
+    {
+        fs::path reportPath{path};
+        fs::create_directories(reportPath.parent_path());
+
+        auto tmpPath = reportPath;
+        tmpPath += ".tmp";
+        {
+            std::ofstream file{tmpPath, std::ios::trunc};
+            file << report.dump(4) << '\n';
+            if (!file)
+            {
+                throw std::runtime_error("short write");
+            }
+        }
+        fs::rename(tmpPath, reportPath);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to write {PATH}: {ERROR}", "PATH", path, "ERROR",
+                   e);
+    }
+}
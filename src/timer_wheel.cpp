@@ -0,0 +1,229 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <bit>
+
+TimerWheel::TimerWheel() :
+    start(Clock::now()),
+    source(sdeventplus::Event::get_default(),
+           [this](SourceTimer&) { expire(); })
+{
+    for (unsigned level = 0; level < levelCount; level++)
+    {
+        for (unsigned index = 0; index < slotCount; index++)
+        {
+            slots[level][index].level = level;
+            slots[level][index].index = index;
+        }
+    }
+    source.setEnabled(false);
+}
+
+uint64_t TimerWheel::toTick(Clock::time_point time) const
+{
+    return std::max(std::chrono::ceil<Duration>(time - start).count(),
+                    Duration::rep(0));
+}
+
+uint64_t TimerWheel::nowTick() const
+{
+    return std::chrono::floor<Duration>(Clock::now() - start).count();
+}
+
+TimerWheel::Clock::time_point TimerWheel::toTime(uint64_t tick) const
+{
+    return start + Duration(tick);
+}
+
+void TimerWheel::insert(Timer& timer)
+{
+    // a timer due now is only inserted by a cascade, it fires with the
+    // slot of the current tick
+    uint64_t delta = std::min(timer.expiry - current, maxDelta);
+
+    unsigned level = 0;
+    while ((level < levelCount - 1) &&
+           (delta >= (uint64_t(1) << (levelBits * (level + 1)))))
+    {
+        level++;
+    }
+
+    auto& slot = slots[level][((current + delta) >> (levelBits * level)) &
+                              slotMask];
+    timer.node.prev = slot.head.prev;
+    timer.node.next = &slot.head;
+    slot.head.prev->next = &timer.node;
+    slot.head.prev = &timer.node;
+    timer.slot = &slot;
+    occupied[level] |= uint64_t(1) << slot.index;
+}
+
+void TimerWheel::unlink(Timer& timer)
+{
+    if (timer.slot == nullptr)
+    {
+        return;
+    }
+
+    timer.node.prev->next = timer.node.next;
+    timer.node.next->prev = timer.node.prev;
+    timer.node.prev = timer.node.next = &timer.node;
+
+    auto& slot = *timer.slot;
+    if (slot.head.next == &slot.head)
+    {
+        occupied[slot.level] &= ~(uint64_t(1) << slot.index);
+    }
+    timer.slot = nullptr;
+}
+
+std::optional<uint64_t> TimerWheel::nextTick() const
+{
+    std::optional<uint64_t> next;
+
+    for (unsigned level = 0; level < levelCount; level++)
+    {
+        if (occupied[level] == 0)
+        {
+            continue;
+        }
+
+        // the slot of the current tick is done at every level, a timer
+        // still in it is one turn of the level away
+        unsigned shift = levelBits * level;
+        uint64_t position = (current >> shift) & slotMask;
+        auto distance = std::countr_zero(std::rotr(
+                            occupied[level], static_cast<int>(position + 1))) +
+                        1;
+        uint64_t tick = ((current >> shift) + distance) << shift;
+        next = std::min(next.value_or(tick), tick);
+    }
+    return next;
+}
+
+void TimerWheel::expire()
+{
+    uint64_t now = nowTick();
+
+    // jump from one slot holding timers to the next
+    for (auto next = nextTick(); next && (*next <= now); next = nextTick())
+    {
+        current = *next;
+
+        // the upper levels first, a timer they move down may be due now
+        for (unsigned level = levelCount - 1; level > 0; level--)
+        {
+            unsigned shift = levelBits * level;
+            if ((current & ((uint64_t(1) << shift) - 1)) == 0)
+            {
+                cascade(slots[level][(current >> shift) & slotMask]);
+            }
+        }
+        fire(slots[0][current & slotMask]);
+    }
+
+    // no slot is due in between, the timers keep their slots
+    current = std::max(current, now);
+    schedule();
+}
+
+void TimerWheel::cascade(Slot& slot)
+{
+    while (slot.head.next != &slot.head)
+    {
+        auto& timer = *slot.head.next->timer;
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+void TimerWheel::fire(Slot& slot)
+{
+    // a callback may arm or cancel any timer, but a timer armed now can't
+    // land in the slot of the current tick
+    while (slot.head.next != &slot.head)
+    {
+        auto& timer = *slot.head.next->timer;
+        unlink(timer);
+        if (timer.interval)
+        {
+            timer.expiry = std::max(timer.expiry + timer.interval->count(),
+                                    current + 1);
+            insert(timer);
+        }
+        // the timer may be gone once its callback returns
+        timer.callback();
+    }
+}
+
+void TimerWheel::schedule()
+{
+    auto next = nextTick();
+    if (!next)
+    {
+        source.setEnabled(false);
+        return;
+    }
+
+    auto remaining = std::max(toTime(*next) - Clock::now(),
+                              Clock::duration::zero());
+    source.restartOnce(
+        std::chrono::duration_cast<SourceTimer::Duration>(remaining));
+}
+
+TimerWheel::Timer::Timer(Callback callback) : callback(std::move(callback))
+{
+    node.timer = this;
+}
+
+TimerWheel::Timer::~Timer()
+{
+    instance().unlink(*this);
+}
+
+void TimerWheel::Timer::arm(Duration delay)
+{
+    auto& wheel = instance();
+
+    wheel.unlink(*this);
+
+    // catch up with an idle wheel, so the timer lands in the right level
+    auto next = wheel.nextTick();
+    if (!next || (*next > wheel.nowTick()))
+    {
+        wheel.current = std::max(wheel.current, wheel.nowTick());
+    }
+
+    expiry = std::max(wheel.toTick(Clock::now() + delay), wheel.current + 1);
+    wheel.insert(*this);
+    wheel.schedule();
+}
+
+void TimerWheel::Timer::restartOnce(Duration delay)
+{
+    interval.reset();
+    arm(delay);
+}
+
+void TimerWheel::Timer::restart(Duration interval)
+{
+    this->interval = interval;
+    arm(interval);
+}
+
+void TimerWheel::Timer::setEnabled(bool enabled)
+{
+    if (!enabled)
+    {
+        instance().unlink(*this);
+    }
+    else if (!isEnabled())
+    {
+        arm(interval.value_or(Duration(0)));
+    }
+}
+
+bool TimerWheel::Timer::isEnabled() const
+{
+    return slot != nullptr;
+}
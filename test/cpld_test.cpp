@@ -0,0 +1,102 @@
+// Reads the cpld registers of CpldRegisters from a regular file standing in
+// for /dev/i2c-N, where register r of address a is the byte at (a << 8) | r.
+// Run through 'meson test' with -Dtests=enabled.
+
+#include "cpld.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+constexpr uint16_t address = 0x21;
+
+class CpldRegistersTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        int fd = ::mkstemp(path.data());
+        ASSERT_GE(fd, 0);
+        // every register holds its own offset, plus one
+        std::vector<uint8_t> file((address + 1) << 8);
+        for (size_t offset = 0; offset < 256; offset++)
+        {
+            file[(address << 8) | offset] = static_cast<uint8_t>(offset + 1);
+        }
+        ASSERT_EQ(::write(fd, file.data(), file.size()),
+                  static_cast<ssize_t>(file.size()));
+        ::close(fd);
+        ASSERT_EQ(registers.open(path, address), 0);
+    }
+
+    void TearDown() override
+    {
+        ::unlink(path.c_str());
+    }
+
+    std::string path = "/tmp/cpld_test.XXXXXX";
+    CpldRegisters registers;
+};
+
+TEST_F(CpldRegistersTest, GroupsTwoButtonsIntoOneRun)
+{
+    registers.plan({0x12, 0x10});
+    ASSERT_EQ(registers.getRuns().size(), 1);
+    EXPECT_EQ(registers.getRuns()[0].first, 0x10);
+    EXPECT_EQ(registers.getRuns()[0].count, 3);
+
+    ASSERT_TRUE(registers.read());
+    EXPECT_EQ(registers.get(0x10), 0x11);
+    EXPECT_EQ(registers.get(0x11), 0x12);
+    EXPECT_EQ(registers.get(0x12), 0x13);
+
+    // each button decodes its own bits of the registers read
+    CpldDecoder low(CpldDecoder::Format::raw, 0x0f, 0, std::nullopt);
+    CpldDecoder high(CpldDecoder::Format::raw, 0xf0, 4, std::nullopt);
+    EXPECT_EQ(low.decode(registers.get(0x10)), 0x1);
+    EXPECT_EQ(high.decode(registers.get(0x12)), 0x1);
+}
+
+TEST_F(CpldRegistersTest, SplitsRunsOnAGap)
+{
+    // three registers apart still share a run, four don't
+    registers.plan({0x10, 0x14, 0x19});
+    ASSERT_EQ(registers.getRuns().size(), 2);
+    EXPECT_EQ(registers.getRuns()[0].first, 0x10);
+    EXPECT_EQ(registers.getRuns()[0].count, 5);
+    EXPECT_EQ(registers.getRuns()[1].first, 0x19);
+    EXPECT_EQ(registers.getRuns()[1].count, 1);
+
+    ASSERT_TRUE(registers.read());
+    EXPECT_EQ(registers.get(0x14), 0x15);
+    EXPECT_EQ(registers.get(0x19), 0x1a);
+    // the gap between the runs isn't read
+    EXPECT_EQ(registers.get(0x17), 0);
+}
+
+TEST_F(CpldRegistersTest, ReadsTheSpanPastTheMessageLimit)
+{
+    std::vector<uint8_t> offsets;
+    for (size_t offset = 0; offset < 256; offset += 8)
+    {
+        offsets.push_back(static_cast<uint8_t>(offset));
+    }
+    registers.plan(offsets);
+    ASSERT_EQ(registers.getRuns().size(), 1);
+    EXPECT_EQ(registers.getRuns()[0].first, 0);
+    EXPECT_EQ(registers.getRuns()[0].count, 249);
+
+    ASSERT_TRUE(registers.read());
+    EXPECT_EQ(registers.get(0xf8), 0xf9);
+}
+
+TEST_F(CpldRegistersTest, FailsOnAShortRead)
+{
+    ASSERT_EQ(::truncate(path.c_str(), (address << 8) | 0x11), 0);
+    registers.plan({0x10, 0x12});
+    EXPECT_FALSE(registers.read());
+}
@@ -0,0 +1,122 @@
+// Hands named fds to FdStore the way systemd passes the fd store of the
+// service, through LISTEN_PID, LISTEN_FDS and LISTEN_FDNAMES, and adopts
+// them into button configs. Run through 'meson test' with -Dtests=enabled.
+
+#include "fd_store.hpp"
+
+#include <fcntl.h>
+#include <systemd/sd-daemon.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+const std::string gpioKey = "POWER_BUTTON-0000000000000001";
+const std::string cpldKey = "HOST_SELECTOR-0000000000000002";
+const std::string shortKey = "RESET_BUTTON-0000000000000003";
+
+// the passed fds, from SD_LISTEN_FDS_START on
+const std::vector<std::string> passedNames = {
+    gpioKey + "-0", gpioKey + "-1", cpldKey + "-0", shortKey + "-0"};
+
+class FdStoreTest : public ::testing::Test
+{
+  protected:
+    static void SetUpTestSuite()
+    {
+        // opened past the passed fds, then duplicated onto each of them
+        int count = static_cast<int>(passedNames.size());
+        int null = ::open("/dev/null", O_RDONLY);
+        ASSERT_GE(null, 0);
+        int fd = ::fcntl(null, F_DUPFD, SD_LISTEN_FDS_START + count);
+        ::close(null);
+        ASSERT_GE(fd, 0);
+
+        std::string names;
+        for (int index = 0; index < count; index++)
+        {
+            int passed = SD_LISTEN_FDS_START + index;
+            ASSERT_EQ(::dup2(fd, passed), passed);
+            names += (index > 0 ? ":" : "") + passedNames[index];
+        }
+        ::close(fd);
+        ::setenv("LISTEN_PID", std::to_string(::getpid()).c_str(), 1);
+        ::setenv("LISTEN_FDS", std::to_string(count).c_str(), 1);
+        ::setenv("LISTEN_FDNAMES", names.c_str(), 1);
+
+        // the store reads the passed fds once, when first used
+        FdStore::instance();
+    }
+
+    static ButtonConfig makeGpioConfig(const std::string& key)
+    {
+        ButtonConfig config{};
+        config.type = ConfigType::gpio;
+        config.formFactorName = "POWER_BUTTON";
+        config.fdStoreKey = key;
+        // a gpiochip each, a line request each with gpio-chardev
+        config.gpios.resize(2);
+        config.gpios[0].chipId = 0;
+        config.gpios[1].chipId = 1;
+        return config;
+    }
+};
+
+TEST_F(FdStoreTest, AdoptsTheFdsOfAGpioButton)
+{
+    auto config = makeGpioConfig(gpioKey);
+    ASSERT_TRUE(FdStore::instance().adopt(config));
+
+    std::vector<int> expected = {SD_LISTEN_FDS_START, SD_LISTEN_FDS_START + 1};
+    EXPECT_EQ(config.fds, expected);
+    EXPECT_EQ(config.gpios[0].fd, SD_LISTEN_FDS_START);
+    EXPECT_EQ(config.gpios[1].fd, SD_LISTEN_FDS_START + 1);
+
+    // the fds go to a single button
+    auto again = makeGpioConfig(gpioKey);
+    EXPECT_FALSE(FdStore::instance().adopt(again));
+}
+
+TEST_F(FdStoreTest, AdoptsTheFdOfACpldButton)
+{
+    ButtonConfig config{};
+    config.type = ConfigType::cpld;
+    config.formFactorName = "HOST_SELECTOR";
+    config.fdStoreKey = cpldKey;
+    ASSERT_TRUE(FdStore::instance().adopt(config));
+
+    EXPECT_EQ(config.cpld.cpldMappedFd, SD_LISTEN_FDS_START + 2);
+    EXPECT_EQ(config.fds, std::vector<int>{SD_LISTEN_FDS_START + 2});
+}
+
+TEST_F(FdStoreTest, ConfiguresAButtonWhoseFdsDontMatch)
+{
+    // a single fd for two gpios on two chips
+    auto config = makeGpioConfig(shortKey);
+    EXPECT_FALSE(FdStore::instance().adopt(config));
+    EXPECT_TRUE(config.fds.empty());
+    EXPECT_EQ(config.gpios[0].fd, -1);
+}
+
+TEST_F(FdStoreTest, ConfiguresAButtonWithoutStoredFds)
+{
+    auto config = makeGpioConfig("ID_BUTTON-0000000000000004");
+    EXPECT_FALSE(FdStore::instance().adopt(config));
+
+    config.fdStoreKey.clear();
+    EXPECT_FALSE(FdStore::instance().adopt(config));
+}
+
+// after the other tests, the fds they adopted stay open
+TEST_F(FdStoreTest, ClosesTheFdsNoButtonAdopted)
+{
+    auto config = makeGpioConfig(shortKey);
+    EXPECT_FALSE(FdStore::instance().adopt(config));
+
+    FdStore::instance().releaseUnused();
+    EXPECT_EQ(::fcntl(SD_LISTEN_FDS_START + 3, F_GETFD), -1);
+    EXPECT_GE(::fcntl(SD_LISTEN_FDS_START, F_GETFD), 0);
+}